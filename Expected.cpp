@@ -28,8 +28,36 @@
 #include <wtf/Expected.h>
 
 #include <cstdio>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+namespace TestWebKitAPI {
+
+enum class CallError { Runtime, Logic, Unknown };
+
+} // namespace TestWebKitAPI
+
+namespace WTF {
+
+template <> struct expected_exception_translator<TestWebKitAPI::CallError> {
+    TestWebKitAPI::CallError operator()() const
+    {
+        try {
+            throw;
+        } catch (const std::runtime_error&) {
+            return TestWebKitAPI::CallError::Runtime;
+        } catch (const std::logic_error&) {
+            return TestWebKitAPI::CallError::Logic;
+        } catch (...) {
+            return TestWebKitAPI::CallError::Unknown;
+        }
+    }
+};
+
+} // namespace WTF
 
 namespace TestWebKitAPI {
 
@@ -280,6 +308,541 @@ TEST(WTF_Expected, expected_void)
     }
 }
 
+TEST(WTF_Expected, expected_reference)
+{
+    typedef expected<int&, const char*> E;
+    typedef expected<const int&, const char*> CE;
+    typedef expected<std::string&, std::string> String;
+    {
+        int i = 42;
+        auto e = E(i);
+        EXPECT_TRUE(e.has_value());
+        EXPECT_EQ(&e.value(), &i);
+        EXPECT_EQ(&*e, &i);
+        EXPECT_EQ(e.value_or(3), 42);
+        e.value() = 1024;
+        EXPECT_EQ(i, 1024);
+        const auto e2(e);
+        EXPECT_EQ(&e2.value(), &i);
+        *e2 = 42;
+        EXPECT_EQ(i, 42);
+    }
+    {
+        int i = 42;
+        int j = 1024;
+        E e(i);
+        e = j;
+        EXPECT_EQ(&e.value(), &j);
+        EXPECT_EQ(i, 42);
+        EXPECT_EQ(j, 1024);
+        E e2(i);
+        e = e2;
+        EXPECT_EQ(&e.value(), &i);
+        EXPECT_EQ(j, 1024);
+    }
+    {
+        int i = 42;
+        CE c = E(i);
+        EXPECT_EQ(&c.value(), &i);
+        CE u = E(make_unexpected(oops));
+        EXPECT_FALSE(u.has_value());
+        EXPECT_EQ(u.error(), oops);
+    }
+    {
+        auto u = E(make_unexpected(oops));
+        EXPECT_FALSE(u.has_value());
+        EXPECT_EQ(u.error(), oops);
+        EXPECT_EQ(u.get_unexpected().value(), oops);
+        EXPECT_EQ(u.value_or(3), 3);
+    }
+    {
+        int i = 42;
+        int j = 1024;
+        auto e0 = E(i);
+        auto e1 = E(j);
+        swap(e0, e1);
+        EXPECT_EQ(&e0.value(), &j);
+        EXPECT_EQ(&e1.value(), &i);
+        auto e2 = E(make_unexpected(oops));
+        swap(e0, e2);
+        EXPECT_EQ(e0.error(), oops);
+        EXPECT_EQ(&e2.value(), &j);
+        swap(e0, e2);
+        EXPECT_EQ(&e0.value(), &j);
+        EXPECT_EQ(e2.error(), oops);
+    }
+    {
+        std::unordered_map<int, std::string> m { { 42, "forty-two" } };
+        auto find = [&] (int k) -> String {
+            auto it = m.find(k);
+            if (it == m.end())
+                return make_unexpected(std::string(oops));
+            return it->second;
+        };
+        auto f = find(42);
+        EXPECT_EQ(&f.value(), &m[42]);
+        EXPECT_EQ(f->size(), 9u);
+        f->append("!");
+        EXPECT_EQ(m[42], "forty-two!");
+        auto n = find(0);
+        EXPECT_EQ(n.error(), oops);
+        EXPECT_EQ(n.value_or("zero"), "zero");
+    }
+    {
+        typedef expected<int, const char*>::rebind<int&>::type R;
+        EXPECT_TRUE((std::is_same<R, E>::value));
+        EXPECT_TRUE((std::is_same<E::rebind<int>::type, expected<int, const char*>>::value));
+        EXPECT_TRUE(sizeof(E) == sizeof(expected<int*, const char*>));
+    }
+}
+
+static int add(int a, int b) noexcept { return a + b; }
+static int parse(const std::string& s) { return std::stoi(s); }
+static void check(bool ok) { if (!ok) throw std::logic_error("check"); }
+
+TEST(WTF_Expected, make_expected_from_call)
+{
+    {
+        auto e = make_expected_from_call<CallError>(add, 40, 2);
+        EXPECT_TRUE((std::is_same<decltype(e), expected<int, CallError>>::value));
+        EXPECT_EQ(e.value(), 42);
+    }
+    {
+        // Noexcept callees don't need a translator for their error type.
+        auto e = make_expected_from_call<std::string>([] (int i) noexcept { return i * 2; }, 21);
+        EXPECT_EQ(e.value(), 42);
+    }
+    {
+        auto e = make_expected_from_call<CallError>(parse, std::string("1024"));
+        EXPECT_EQ(e.value(), 1024);
+        auto u = make_expected_from_call<CallError>(parse, std::string(oops));
+        EXPECT_FALSE(u.has_value());
+        EXPECT_EQ(u.error(), CallError::Logic);
+        auto r = make_expected_from_call<CallError>([] () -> int { throw std::runtime_error(oops); });
+        EXPECT_EQ(r.error(), CallError::Runtime);
+        auto k = make_expected_from_call<CallError>([] () -> int { throw 42; });
+        EXPECT_EQ(k.error(), CallError::Unknown);
+    }
+    {
+        auto e = make_expected_from_call<CallError>(check, true);
+        EXPECT_TRUE((std::is_same<decltype(e), expected<void, CallError>>::value));
+        EXPECT_TRUE(e.has_value());
+        auto u = make_expected_from_call<CallError>(check, false);
+        EXPECT_EQ(u.error(), CallError::Logic);
+    }
+    {
+        int i = 42;
+        auto e = make_expected_from_call<CallError>([&] () noexcept -> int& { return i; });
+        EXPECT_TRUE((std::is_same<decltype(e), expected<int&, CallError>>::value));
+        EXPECT_EQ(&e.value(), &i);
+    }
+    {
+        auto e = make_expected_from_call(parse, std::string(oops));
+        EXPECT_TRUE((std::is_same<decltype(e), expected<int, WTF::nullopt_t>>::value));
+        EXPECT_FALSE(e.has_value());
+    }
+    {
+        auto e = make_expected_from_call<std::exception_ptr>(parse, std::string(oops));
+        EXPECT_FALSE(e.has_value());
+        bool caught = false;
+        try {
+            value_or_throw(std::move(e));
+        } catch (const std::invalid_argument&) {
+            caught = true;
+        }
+        EXPECT_TRUE(caught);
+    }
+}
+
+TEST(WTF_Expected, value_or_throw)
+{
+    typedef expected<int, CallError> E;
+    typedef expected<void, CallError> V;
+    {
+        const E e(42);
+        EXPECT_EQ(value_or_throw(e), 42);
+        EXPECT_EQ(value_or_throw(E(1024)), 1024);
+        value_or_throw(V());
+    }
+    {
+        bool caught = false;
+        try {
+            value_or_throw(E(make_unexpected(CallError::Runtime)));
+        } catch (const WTF::bad_expected_access<CallError>& e) {
+            caught = e.error() == CallError::Runtime;
+        }
+        EXPECT_TRUE(caught);
+    }
+    {
+        const V v = make_unexpected(CallError::Logic);
+        bool caught = false;
+        try {
+            value_or_throw(v);
+        } catch (const std::exception&) {
+            caught = true;
+        }
+        EXPECT_TRUE(caught);
+    }
+}
+
+struct ThrowingMove {
+    ThrowingMove() { }
+    ThrowingMove(const ThrowingMove&) { }
+    ThrowingMove(ThrowingMove&&) { }
+    ThrowingMove& operator=(const ThrowingMove&) { return *this; }
+    ThrowingMove& operator=(ThrowingMove&&) { return *this; }
+};
+
+static_assert(std::is_nothrow_move_constructible<expected<std::string, int>>::value, "");
+static_assert(std::is_nothrow_move_constructible<expected<int, std::string>>::value, "");
+static_assert(std::is_nothrow_move_constructible<expected<void, std::string>>::value, "");
+static_assert(std::is_nothrow_move_constructible<expected<std::string&, std::string>>::value, "");
+static_assert(!std::is_nothrow_move_constructible<expected<ThrowingMove, int>>::value, "");
+static_assert(!std::is_nothrow_move_constructible<expected<int, ThrowingMove>>::value, "");
+static_assert(!std::is_nothrow_move_constructible<expected<void, ThrowingMove>>::value, "");
+static_assert(std::is_nothrow_copy_constructible<expected<int, const char*>>::value, "");
+static_assert(!std::is_nothrow_copy_constructible<expected<std::string, int>>::value, "");
+static_assert(std::is_nothrow_copy_assignable<expected<int, const char*>>::value, "");
+static_assert(std::is_nothrow_move_assignable<expected<int, const char*>>::value, "");
+static_assert(std::is_nothrow_move_assignable<expected<void, int>>::value, "");
+static_assert(!std::is_nothrow_move_assignable<expected<ThrowingMove, int>>::value, "");
+static_assert(std::is_nothrow_default_constructible<expected<int, std::string>>::value, "");
+static_assert(!std::is_nothrow_default_constructible<expected<ThrowingMove, int>>::value, "");
+static_assert(std::is_nothrow_swappable<expected<int, const char*>>::value, "");
+static_assert(!std::is_nothrow_swappable<expected<ThrowingMove, int>>::value, "");
+static_assert(std::is_nothrow_constructible<expected<std::string, int>, std::string&&>::value, "");
+static_assert(!std::is_nothrow_constructible<expected<std::string, int>, const std::string&>::value, "");
+static_assert(std::is_nothrow_constructible<expected<int, int>, unexpected_type<int>>::value, "");
+static_assert(std::is_nothrow_constructible<expected<int&, int>, int&>::value, "");
+static_assert(noexcept(std::declval<expected<std::string, int>&>().has_value()), "");
+static_assert(noexcept(*std::declval<expected<std::string, int>&>()), "");
+static_assert(noexcept(std::declval<expected<std::string, int>&>().value()), "");
+static_assert(noexcept(std::declval<expected<std::string, int>&>().error()), "");
+static_assert(noexcept(std::declval<expected<void, int>&>().error()), "");
+static_assert(!noexcept(std::declval<const expected<std::string, int>&>().value_or("")), "");
+static_assert(noexcept(std::declval<const expected<int, int>&>().value_or(0)), "");
+
+// Without WTF_EXPECTED_CHECKED, checking takes no space, keeps expected trivially copy-constructible and
+// destructible, and adds nothing to the accessors, which still fold to constants.
+static_assert(!WTF_EXPECTED_CHECKED, "");
+static_assert(std::is_empty<WTF::ExpectedDetail::expected_check_state>::value, "");
+static_assert(sizeof(expected<int, int>) == 2 * sizeof(int), "");
+static_assert(sizeof(expected<char, char>) == 2, "");
+static_assert(sizeof(expected<void, int>) == 2 * sizeof(int), "");
+static_assert(sizeof(expected<int&, int>) == 2 * sizeof(int*), "");
+static_assert(std::is_trivially_copy_constructible<expected<int, int>>::value, "");
+static_assert(std::is_trivially_destructible<expected<int, int>>::value, "");
+static_assert(std::is_trivially_destructible<expected<void, int>>::value, "");
+constexpr expected<int, int> foldedValue = 3;
+static_assert(foldedValue.has_value() && *foldedValue == 3 && foldedValue.value() == 3, "");
+
+struct MoveCounted {
+    static unsigned copies;
+    static unsigned moves;
+    int v;
+    MoveCounted(int v) : v(v) { }
+    MoveCounted(const MoveCounted& o) : v(o.v) { ++copies; }
+    MoveCounted(MoveCounted&& o) noexcept : v(o.v) { ++moves; }
+    MoveCounted& operator=(const MoveCounted& o) { v = o.v; ++copies; return *this; }
+    MoveCounted& operator=(MoveCounted&& o) noexcept { v = o.v; ++moves; return *this; }
+};
+unsigned MoveCounted::copies;
+unsigned MoveCounted::moves;
+
+TEST(WTF_Expected, vector_growth)
+{
+    typedef expected<MoveCounted, std::string> E;
+    std::vector<E> v;
+    MoveCounted::copies = 0;
+    MoveCounted::moves = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3)
+            v.emplace_back(MoveCounted(i));
+        else
+            v.emplace_back(make_unexpected(std::string(128, 'e')));
+    }
+    EXPECT_EQ(MoveCounted::copies, 0u);
+    MoveCounted::moves = 0;
+    v.reserve(v.capacity() * 2);
+    EXPECT_EQ(MoveCounted::copies, 0u);
+    EXPECT_EQ(MoveCounted::moves, 666u);
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3)
+            EXPECT_EQ(v[i]->v, i);
+        else
+            EXPECT_EQ(v[i].error().size(), 128u);
+    }
+}
+
+struct Buffer {
+    explicit Buffer(int v) : v(v) { }
+    int v;
+};
+
+static_assert(!std::is_copy_constructible<expected<std::unique_ptr<Buffer>, int>>::value, "");
+static_assert(!std::is_copy_constructible<expected<int, std::unique_ptr<Buffer>>>::value, "");
+static_assert(!std::is_copy_constructible<expected<void, std::unique_ptr<Buffer>>>::value, "");
+static_assert(std::is_nothrow_move_constructible<expected<std::unique_ptr<Buffer>, int>>::value, "");
+static_assert(std::is_nothrow_move_assignable<expected<std::unique_ptr<Buffer>, std::unique_ptr<Buffer>>>::value, "");
+static_assert(std::is_nothrow_swappable<expected<std::unique_ptr<Buffer>, std::string>>::value, "");
+static_assert(sizeof(expected<std::unique_ptr<Buffer>, int>) == sizeof(expected<Buffer*, int>), "");
+static_assert(!std::is_copy_assignable<expected<std::unique_ptr<Buffer>, int>>::value, "");
+static_assert(!std::is_copy_assignable<expected<int, std::unique_ptr<Buffer>>>::value, "");
+static_assert(!std::is_copy_assignable<expected<void, std::unique_ptr<Buffer>>>::value, "");
+static_assert(!std::is_copy_assignable<expected<int&, std::unique_ptr<Buffer>>>::value, "");
+static_assert(std::is_copy_assignable<expected<std::string, std::string>>::value, "");
+static_assert(!std::is_assignable<expected<int, int>&, std::string>::value, "");
+static_assert(std::is_assignable<expected<long, int>&, int>::value, "");
+
+// Trivially destructible, but not trivially copyable or movable.
+struct Fd {
+    explicit Fd(int fd) : fd(fd) { }
+    Fd(Fd&&) = default;
+    Fd(const Fd&) = delete;
+    Fd& operator=(Fd&&) = default;
+    int fd;
+};
+
+static_assert(std::is_nothrow_move_constructible<expected<Fd, int>>::value, "");
+static_assert(std::is_move_assignable<expected<Fd, int>>::value, "");
+static_assert(!std::is_copy_constructible<expected<Fd, int>>::value, "");
+static_assert(std::is_move_constructible<expected<int, Fd>>::value, "");
+static_assert(std::is_move_constructible<expected<void, Fd>>::value, "");
+static_assert(std::is_copy_constructible<expected<MoveCounted, int>>::value, "");
+static_assert(std::is_move_constructible<expected<MoveCounted, int>>::value, "");
+
+struct Shape {
+    virtual ~Shape() = default;
+    virtual int sides() const = 0;
+};
+
+struct Square : Shape {
+    int sides() const override { return 4; }
+};
+
+// Converting an unexpected is only implicit when converting its error is.
+static_assert(std::is_convertible<unexpected_type<std::unique_ptr<Square>>, expected<int, std::unique_ptr<Shape>>>::value, "");
+static_assert(!std::is_convertible<unexpected_type<int>, expected<int, std::vector<int>>>::value, "");
+static_assert(!std::is_convertible<const unexpected_type<int>&, expected<void, std::vector<int>>>::value, "");
+static_assert(!std::is_convertible<unexpected_type<int*>, expected<int, std::unique_ptr<int>>>::value, "");
+static_assert(!std::is_convertible<unexpected_type<int*>, expected<int&, std::unique_ptr<int>>>::value, "");
+static_assert(std::is_constructible<expected<int, std::vector<int>>, unexpected_type<int>>::value, "");
+static_assert(std::is_constructible<expected<int, std::unique_ptr<int>>, unexpected_type<int*>>::value, "");
+
+TEST(WTF_Expected, trivially_destructible_payloads)
+{
+    std::vector<expected<MoveCounted, int>> v;
+    for (int i = 0; i < 10; ++i) {
+        if (i % 2)
+            v.emplace_back(MoveCounted(i));
+        else
+            v.emplace_back(make_unexpected(i));
+    }
+    MoveCounted::copies = 0;
+    MoveCounted::moves = 0;
+    v.reserve(v.capacity() * 2);
+    EXPECT_EQ(MoveCounted::copies, 0u);
+    EXPECT_EQ(MoveCounted::moves, 5u);
+    EXPECT_EQ(v[3]->v, 3);
+    EXPECT_EQ(v[4].error(), 4);
+
+    expected<Fd, int> fd = Fd(3);
+    expected<Fd, int> moved = std::move(fd);
+    EXPECT_EQ(moved->fd, 3);
+    moved = make_unexpected(1);
+    EXPECT_EQ(moved.error(), 1);
+}
+
+TEST(WTF_Expected, move_only)
+{
+    typedef expected<std::unique_ptr<Buffer>, std::unique_ptr<Buffer>> E;
+    typedef expected<void, std::unique_ptr<Buffer>> V;
+    {
+        E e(std::make_unique<Buffer>(42));
+        EXPECT_EQ(e.value()->v, 42);
+        E m(std::move(e));
+        EXPECT_EQ((*m)->v, 42);
+        Buffer* raw = m->get();
+        E n = make_unexpected(std::make_unique<Buffer>(1024));
+        EXPECT_EQ(n.error()->v, 1024);
+        n = std::move(m);
+        EXPECT_EQ(n.value().get(), raw);
+        n = std::make_unique<Buffer>(7);
+        EXPECT_EQ((*n)->v, 7);
+        n = make_unexpected(std::make_unique<Buffer>(8));
+        EXPECT_EQ(n.error()->v, 8);
+        std::unique_ptr<Buffer> taken = std::move(n).error();
+        EXPECT_EQ(taken->v, 8);
+    }
+    {
+        E e0(std::make_unique<Buffer>(42));
+        E e1 = make_unexpected(std::make_unique<Buffer>(1024));
+        swap(e0, e1);
+        EXPECT_EQ(e0.error()->v, 1024);
+        EXPECT_EQ((*e1)->v, 42);
+        swap(e0, e1);
+        EXPECT_EQ((*e0)->v, 42);
+        EXPECT_EQ(e1.error()->v, 1024);
+    }
+    {
+        E e(std::make_unique<Buffer>(42));
+        std::unique_ptr<Buffer> b = std::move(e).value_or(nullptr);
+        EXPECT_EQ(b->v, 42);
+        E u = make_unexpected(std::make_unique<Buffer>(1024));
+        EXPECT_FALSE(std::move(u).value_or(nullptr));
+        std::unique_ptr<Buffer> v = std::move(E(std::make_unique<Buffer>(1))).value();
+        EXPECT_EQ(v->v, 1);
+    }
+    {
+        expected<int, std::unique_ptr<Shape>> e = make_unexpected(std::make_unique<Square>());
+        EXPECT_EQ(e.error()->sides(), 4);
+        expected<void, std::unique_ptr<Shape>> v = make_unexpected(std::make_unique<Square>());
+        EXPECT_EQ(v.error()->sides(), 4);
+        int i = 0;
+        expected<int&, std::unique_ptr<Shape>> r = make_unexpected(std::make_unique<Square>());
+        EXPECT_EQ(r.error()->sides(), 4);
+        r = i;
+        EXPECT_EQ(&*r, &i);
+    }
+    {
+        auto e = make_expected(std::make_unique<Buffer>(42));
+        EXPECT_EQ((*e)->v, 42);
+        auto u = make_expected_from_error<int>(std::make_unique<Buffer>(1024));
+        EXPECT_EQ(u.error()->v, 1024);
+    }
+    {
+        V v = make_unexpected(std::make_unique<Buffer>(42));
+        V w;
+        swap(v, w);
+        EXPECT_TRUE(v.has_value());
+        EXPECT_EQ(w.error()->v, 42);
+        v = std::move(w);
+        EXPECT_EQ(v.error()->v, 42);
+    }
+    {
+        std::vector<E> v;
+        for (int i = 0; i < 100; ++i)
+            v.push_back(std::make_unique<Buffer>(i));
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(v[i].value()->v, i);
+    }
+}
+
+#if WTF_EXPECTED_EXCEPTIONS
+template <bool throwingMove>
+struct LiveCounted {
+    static int live;
+    static bool failMoves;
+    int v;
+    explicit LiveCounted(int v) : v(v) { ++live; }
+    LiveCounted(const LiveCounted& o) : v(o.v) { ++live; }
+    LiveCounted(LiveCounted&& o) noexcept(!throwingMove)
+        : v(o.v)
+    {
+        if constexpr (throwingMove) {
+            if (failMoves)
+                throw std::runtime_error("move");
+        }
+        ++live;
+    }
+    LiveCounted& operator=(const LiveCounted&) = default;
+    LiveCounted& operator=(LiveCounted&&) = default;
+    ~LiveCounted() { --live; }
+};
+template <bool throwingMove> int LiveCounted<throwingMove>::live;
+template <bool throwingMove> bool LiveCounted<throwingMove>::failMoves;
+typedef LiveCounted<true> FailingMove;
+typedef LiveCounted<false> SafeMove;
+
+template <class E> static bool swapThrows(E& a, E& b)
+{
+    try {
+        a.swap(b);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+TEST(WTF_Expected, swap_with_throwing_move)
+{
+    // Whichever side's move throws, both keep what they held and nothing is destroyed twice.
+    {
+        typedef expected<FailingMove, SafeMove> E;
+        E value = FailingMove(1);
+        E error = make_unexpected(SafeMove(2));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        EXPECT_TRUE(swapThrows(error, value));
+        FailingMove::failMoves = false;
+        EXPECT_EQ(value->v, 1);
+        EXPECT_EQ(error.error().v, 2);
+        EXPECT_FALSE(swapThrows(value, error));
+        EXPECT_EQ(value.error().v, 2);
+        EXPECT_EQ(error->v, 1);
+    }
+    {
+        typedef expected<SafeMove, FailingMove> E;
+        E value = SafeMove(1);
+        E error = make_unexpected(FailingMove(2));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        EXPECT_TRUE(swapThrows(error, value));
+        FailingMove::failMoves = false;
+        EXPECT_EQ(value->v, 1);
+        EXPECT_EQ(error.error().v, 2);
+        EXPECT_FALSE(swapThrows(value, error));
+        EXPECT_EQ(value.error().v, 2);
+        EXPECT_EQ(error->v, 1);
+    }
+    {
+        typedef expected<FailingMove, FailingMove> E;
+        E value = FailingMove(1);
+        E error = make_unexpected(FailingMove(2));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        FailingMove::failMoves = false;
+        EXPECT_EQ(value->v, 1);
+        EXPECT_EQ(error.error().v, 2);
+    }
+    EXPECT_EQ(FailingMove::live, 0);
+    EXPECT_EQ(SafeMove::live, 0);
+}
+#endif
+
+TEST(WTF_Expected, swap_moves)
+{
+    typedef expected<MoveCounted, MoveCounted> E;
+    {
+        E e0(MoveCounted(42));
+        E e1 = make_unexpected(MoveCounted(1024));
+        MoveCounted::copies = 0;
+        MoveCounted::moves = 0;
+        swap(e0, e1);
+        EXPECT_EQ(MoveCounted::copies, 0u);
+        EXPECT_EQ(MoveCounted::moves, 3u);
+        EXPECT_EQ(e0.error().v, 1024);
+        EXPECT_EQ(e1->v, 42);
+        MoveCounted::moves = 0;
+        swap(e0, e1);
+        EXPECT_EQ(MoveCounted::copies, 0u);
+        EXPECT_EQ(MoveCounted::moves, 3u);
+        EXPECT_EQ(e0->v, 42);
+        EXPECT_EQ(e1.error().v, 1024);
+    }
+    {
+        typedef expected<void, MoveCounted> V;
+        V v0;
+        V v1 = make_unexpected(MoveCounted(42));
+        MoveCounted::copies = 0;
+        MoveCounted::moves = 0;
+        swap(v0, v1);
+        EXPECT_EQ(MoveCounted::copies, 0u);
+        EXPECT_EQ(MoveCounted::moves, 1u);
+        EXPECT_EQ(v0.error().v, 42);
+    }
+}
+
 TEST(WTF_Expected, comparison)
 {
     typedef expected<int, const char*> Ex;
@@ -383,6 +946,48 @@ TEST(WTF_Expected, comparison)
     EXPECT_TRUE(make_unexpected(oops) >= Ex(42));
 }
 
+TEST(WTF_Expected, comparison_reference)
+{
+    typedef expected<int&, int> Ex;
+    int i42 = 42;
+    int i1024 = 1024;
+    int other42 = 42;
+
+    EXPECT_TRUE(Ex(i42) == Ex(other42));
+    EXPECT_TRUE(Ex(i42) != Ex(i1024));
+    EXPECT_TRUE(Ex(i42) < Ex(i1024));
+    EXPECT_TRUE(Ex(i1024) > Ex(i42));
+    EXPECT_TRUE(Ex(i42) <= Ex(other42));
+    EXPECT_TRUE(Ex(i42) >= Ex(other42));
+    EXPECT_TRUE(Ex(i42) < Ex(make_unexpected(0)));
+    EXPECT_TRUE(Ex(make_unexpected(0)) > Ex(i42));
+    EXPECT_TRUE(Ex(make_unexpected(0)) == Ex(make_unexpected(0)));
+    EXPECT_TRUE(Ex(make_unexpected(0)) < Ex(make_unexpected(1)));
+
+    EXPECT_TRUE(Ex(i42) == 42);
+    EXPECT_TRUE(Ex(i42) != 0);
+    EXPECT_TRUE(Ex(i42) < 1024);
+    EXPECT_TRUE(Ex(i1024) > 42);
+    EXPECT_TRUE(Ex(i42) <= 42);
+    EXPECT_TRUE(Ex(i42) >= 42);
+    EXPECT_FALSE(Ex(make_unexpected(0)) == 42);
+    EXPECT_FALSE(Ex(make_unexpected(0)) < 42);
+    EXPECT_TRUE(Ex(make_unexpected(0)) > 42);
+
+    EXPECT_TRUE(42 == Ex(i42));
+    EXPECT_TRUE(42 != Ex(i1024));
+    EXPECT_TRUE(42 < Ex(i1024));
+    EXPECT_TRUE(1024 > Ex(i42));
+    EXPECT_TRUE(42 <= Ex(i42));
+    EXPECT_TRUE(42 >= Ex(i42));
+    EXPECT_TRUE(42 < Ex(make_unexpected(0)));
+    EXPECT_FALSE(42 > Ex(make_unexpected(0)));
+
+    EXPECT_FALSE(Ex(i42) == make_unexpected(0));
+    EXPECT_TRUE(Ex(i42) < make_unexpected(0));
+    EXPECT_TRUE(make_unexpected(0) > Ex(i42));
+}
+
 TEST(WTF_Expected, hash)
 {
     typedef expected<int, const char*> E;
@@ -409,4 +1014,21 @@ TEST(WTF_Expected, hash_void)
     EXPECT_EQ(m[E(make_unexpected(foof))], 0xf00f);
 }
 
+TEST(WTF_Expected, hash_reference)
+{
+    typedef expected<const std::string&, const char*> E;
+    std::string s42 = "42";
+    std::string other42 = "42";
+    std::string s1024 = "1024";
+    std::unordered_map<E, int> m;
+    m.insert({ E(s42), 42 });
+    m.insert({ E(make_unexpected(oops)), 5 });
+    m.insert({ E(s1024), 1024 });
+    EXPECT_EQ(m.size(), 3u);
+    EXPECT_EQ(m.at(E(other42)), 42);
+    EXPECT_EQ(m.at(E(s1024)), 1024);
+    EXPECT_EQ(m.at(E(make_unexpected(oops))), 5);
+    EXPECT_EQ(std::hash<E>{ }(E(s42)), std::hash<std::string>{ }(other42));
+}
+
 } // namespace TestWebkitAPI
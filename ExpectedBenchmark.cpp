@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wtf/Expected.h>
+#include <wtf/MemoizeExpected.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned iterations = 50000000;
+
+__attribute__((noinline)) int mayThrow(unsigned i)
+{
+    if (i == iterations)
+        throw std::out_of_range("unreachable");
+    return static_cast<int>(i & 0xff);
+}
+
+__attribute__((noinline)) int cannotThrow(unsigned i) noexcept
+{
+    return static_cast<int>(i & 0xff);
+}
+
+template <class F>
+void run(const char* name, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    long long result = f();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-40s %8.3f ns/call (checksum %lld)\n", name, elapsed / iterations, result);
+}
+
+constexpr unsigned lookupsPerThread = 2000000;
+
+__attribute__((noinline)) expected<int, int> collatzSteps(const unsigned& n)
+{
+    if (!n)
+        return make_unexpected(0);
+    int steps = 0;
+    for (unsigned long long i = n; i != 1; ++steps)
+        i = (i & 1) ? 3 * i + 1 : i / 2;
+    return steps;
+}
+
+// Every thread looks up the same skewed key space, so most lookups hit a small hot set and the rest
+// churn through eviction.
+void runMemoized(unsigned threadCount)
+{
+    memoize_policy policy;
+    policy.capacity = 4096;
+    memoize_expected<unsigned, int, int> memoized(collatzSteps, policy);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&memoized, t] {
+            unsigned state = t * 2654435761u + 1;
+            long long sum = 0;
+            for (unsigned i = 0; i < lookupsPerThread; ++i) {
+                state = state * 1664525u + 1013904223u;
+                unsigned key = (state >> 8) % ((state & 0xf) ? 1024 : 65536);
+                auto e = memoized(key);
+                sum += e ? *e : -1;
+            }
+            if (!sum)
+                std::printf("unlikely\n");
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    memoize_statistics stats = memoized.statistics();
+    double lookups = static_cast<double>(lookupsPerThread) * threadCount;
+    std::printf("memoize_expected, %2u threads %18.2f Mlookups/s (hits %.1f%%, evictions %zu)\n",
+        threadCount, lookups / seconds / 1e6, 100.0 * stats.hits / lookups, stats.evictions);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    // Happy path only: none of these calls throw, so this measures what the exception bridge costs
+    // compared to writing the try/catch by hand.
+    run("raw call, noexcept callee", [] {
+        long long sum = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+            sum += cannotThrow(i);
+        return sum;
+    });
+    run("make_expected_from_call, noexcept callee", [] {
+        long long sum = 0;
+        for (unsigned i = 0; i < iterations; ++i) {
+            auto e = make_expected_from_call<std::exception_ptr>(cannotThrow, i);
+            if (e)
+                sum += *e;
+        }
+        return sum;
+    });
+    run("raw try/catch, throwing callee", [] {
+        long long sum = 0;
+        for (unsigned i = 0; i < iterations; ++i) {
+            try {
+                sum += mayThrow(i);
+            } catch (...) {
+                --sum;
+            }
+        }
+        return sum;
+    });
+    run("make_expected_from_call, throwing callee", [] {
+        long long sum = 0;
+        for (unsigned i = 0; i < iterations; ++i) {
+            auto e = make_expected_from_call<std::exception_ptr>(mayThrow, i);
+            if (e)
+                sum += *e;
+            else
+                --sum;
+        }
+        return sum;
+    });
+
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+        runMemoized(threadCount);
+    return 0;
+}
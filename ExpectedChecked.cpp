@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Built with WTF_EXPECTED_CHECKED=1, in its own executable.
+
+#include "config.h"
+
+#include <wtf/ExpectedErrors.h>
+#include <wtf/MemoizeExpected.h>
+
+#include <chrono>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+static_assert(WTF_EXPECTED_CHECKED, "");
+
+// Checked builds get their own inline namespace, so they can't be linked against unchecked code unnoticed.
+static_assert(std::is_same<expected<int, int>, WTF::expected_checked::expected<int, int>>::value, "");
+static_assert(std::is_same<expected<void, errors<int, long>>, WTF::expected_checked::expected<void, WTF::expected_checked::errors<int, long>>>::value, "");
+static_assert(std::is_same<memoize_expected<int, int, int>, WTF::expected_checked::memoize_expected<int, int, int>>::value, "");
+
+namespace TestWebKitAPI {
+
+typedef std::vector<expected_violation> Violations;
+
+static Violations& recordedViolations()
+{
+    static Violations violations;
+    return violations;
+}
+
+static void recordViolation(expected_violation violation) { recordedViolations().push_back(violation); }
+
+// The violations reported while f runs, including destruction of anything f's body owns.
+template <class F> static Violations violationsDuring(F f)
+{
+    recordedViolations().clear();
+    expected_violation_handler previous = set_expected_violation_handler(recordViolation);
+    f();
+    set_expected_violation_handler(previous);
+    return recordedViolations();
+}
+
+static const Violations none;
+static const Violations uncheckedAccess { expected_violation::unchecked_access };
+static const Violations uncheckedError { expected_violation::unchecked_error_destroyed };
+
+static expected<int, std::string> half(int i)
+{
+    if (i % 2)
+        return make_unexpected(std::string("odd"));
+    return i / 2;
+}
+
+TEST(WTF_ExpectedChecked, checked_access)
+{
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(4);
+        if (e)
+            EXPECT_EQ(*e, 2);
+    }), none);
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        if (!e.has_value())
+            EXPECT_EQ(e.error(), "odd");
+    }), none);
+    EXPECT_EQ(violationsDuring([] { EXPECT_EQ(half(3).value_or(-1), -1); }), none);
+    EXPECT_EQ(violationsDuring([] { EXPECT_EQ(half(3), make_unexpected(std::string("odd"))); }), none);
+}
+
+TEST(WTF_ExpectedChecked, unchecked_access)
+{
+    EXPECT_EQ(violationsDuring([] { EXPECT_EQ(*half(4), 2); }), uncheckedAccess);
+    EXPECT_EQ(violationsDuring([] { EXPECT_EQ(half(4).value(), 2); }), uncheckedAccess);
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(4);
+        EXPECT_EQ(*e, 2);
+        EXPECT_EQ(*e, 2); // Only reported once.
+    }), uncheckedAccess);
+
+    // Reading the error counts as looking at it, so destroying it afterwards isn't reported too.
+    EXPECT_EQ(violationsDuring([] { EXPECT_EQ(half(3).error(), "odd"); }), uncheckedAccess);
+}
+
+TEST(WTF_ExpectedChecked, unchecked_error_destroyed)
+{
+    EXPECT_EQ(violationsDuring([] { half(3); }), uncheckedError);
+    EXPECT_EQ(violationsDuring([] { half(4); }), none);
+
+    // Assigning over an error nobody looked at drops it.
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        e = half(2);
+        EXPECT_TRUE(e.has_value());
+    }), uncheckedError);
+}
+
+TEST(WTF_ExpectedChecked, moves_and_copies)
+{
+    // A move hands the obligation over.
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        auto moved = std::move(e);
+        EXPECT_FALSE(moved);
+    }), none);
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        auto moved = std::move(e);
+    }), uncheckedError);
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        EXPECT_FALSE(e);
+        auto moved = std::move(e);
+    }), none);
+
+    // A copy needs checking on its own.
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        EXPECT_FALSE(e);
+        auto copy = e;
+    }), uncheckedError);
+
+    // Checking a copy doesn't check the original.
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        auto copy = e;
+        EXPECT_FALSE(copy);
+    }), uncheckedError);
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(4);
+        auto copy = e;
+        EXPECT_TRUE(copy);
+        EXPECT_EQ(*e, 2);
+    }), uncheckedAccess);
+
+    EXPECT_EQ(violationsDuring([] {
+        auto e = half(3);
+        auto f = half(4);
+        e.swap(f);
+        EXPECT_TRUE(e);
+    }), uncheckedError);
+}
+
+TEST(WTF_ExpectedChecked, void_and_reference)
+{
+    EXPECT_EQ(violationsDuring([] { expected<void, int> e = make_unexpected(1); }), uncheckedError);
+    EXPECT_EQ(violationsDuring([] { expected<void, int>().value(); }), uncheckedAccess);
+    EXPECT_EQ(violationsDuring([] {
+        int i = 1;
+        expected<int&, int> e = i;
+        if (e)
+            *e = 2;
+    }), none);
+    EXPECT_EQ(violationsDuring([] {
+        int i = 1;
+        expected<int&, int> e = i;
+        EXPECT_EQ(*e, 1);
+    }), uncheckedAccess);
+}
+
+TEST(WTF_ExpectedChecked, multiple_errors)
+{
+    typedef expected<int, errors<std::string, long>> Result;
+    EXPECT_EQ(violationsDuring([] { Result e = make_unexpected(3L); }), uncheckedError);
+    EXPECT_EQ(violationsDuring([] {
+        Result e = make_unexpected(3L);
+        if (e.holds_error<long>())
+            EXPECT_EQ(e.error<long>(), 3L);
+    }), none);
+    EXPECT_EQ(violationsDuring([] {
+        Result e = make_unexpected(3L);
+        EXPECT_EQ(e.visit([](const auto& v) { return sizeof(v); }), sizeof(long));
+    }), none);
+    EXPECT_EQ(violationsDuring([] {
+        Result e = make_unexpected(std::string("x"));
+        EXPECT_EQ(e.visit_error([](const auto& v) { return sizeof(v); }), sizeof(std::string));
+    }), uncheckedAccess);
+}
+
+TEST(WTF_ExpectedChecked, memoize)
+{
+    // The cache's own copies never report, and what it hands out needs checking whether it missed or hit.
+    memoize_policy policy;
+    policy.error_ttl = std::chrono::hours(1);
+    typedef memoize_expected<int, int, std::string> Memo;
+    EXPECT_EQ(violationsDuring([&] {
+        Memo m(half, policy);
+        for (int i = 0; i < 2; ++i) {
+            auto r = m(2);
+            if (r)
+                EXPECT_EQ(*r, 1);
+            auto s = m(3);
+            EXPECT_FALSE(s);
+        }
+    }), none);
+    EXPECT_EQ(violationsDuring([&] {
+        Memo m(half, policy);
+        for (int i = 0; i < 2; ++i) {
+            auto r = m(2);
+            EXPECT_EQ(*r, 1);
+        }
+    }), Violations(2, expected_violation::unchecked_access));
+    EXPECT_EQ(violationsDuring([&] {
+        Memo m(half, policy);
+        for (int i = 0; i < 2; ++i)
+            m(3);
+    }), Violations(2, expected_violation::unchecked_error_destroyed));
+
+    // Errors which aren't cached report the same way.
+    EXPECT_EQ(violationsDuring([] {
+        Memo m(half);
+        m(3);
+    }), uncheckedError);
+}
+
+} // namespace TestWebKitAPI
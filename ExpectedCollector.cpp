@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "Instrumented.h"
+
+#include <wtf/ExpectedCollector.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TestWebKitAPI {
+
+static expected<int, std::string> parse(int i)
+{
+    if (i % 4)
+        return i;
+    return make_unexpected("bad record " + std::to_string(i));
+}
+
+TEST(WTF_ExpectedCollector, collect)
+{
+    expected_collector<std::string, 3> c;
+    EXPECT_EQ(c.capacity(), 3u);
+    EXPECT_TRUE(c.empty());
+    std::vector<int> values;
+    unsigned succeeded = 0;
+    for (int i = 0; i < 20; ++i)
+        succeeded += c.collect(parse(i), [&] (int v) { values.push_back(v); });
+    EXPECT_EQ(succeeded, 15u);
+    EXPECT_EQ(values.size(), 15u);
+    EXPECT_EQ(values.front(), 1);
+    EXPECT_EQ(values.back(), 19);
+    EXPECT_EQ(c.size(), 3u);
+    EXPECT_EQ(c.dropped(), 2u);
+    EXPECT_EQ(c.error_count(), 5u);
+    EXPECT_EQ(*c.begin(), "bad record 0");
+    EXPECT_EQ(c.end() - c.begin(), 3);
+
+    auto result = c.finish();
+    EXPECT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().count(), 5u);
+    EXPECT_EQ(result.error().dropped, 2u);
+    EXPECT_TRUE((result.error().errors == std::vector<std::string> { "bad record 0", "bad record 4", "bad record 8" }));
+    EXPECT_TRUE(c.empty());
+    EXPECT_TRUE(c.finish().has_value());
+}
+
+TEST(WTF_ExpectedCollector, collect_lvalues_and_void)
+{
+    expected_collector<int, 4> c;
+    const expected<int, int> ok(42);
+    const expected<int, int> bad = make_unexpected(1);
+    int sum = 0;
+    EXPECT_TRUE(c.collect(ok, [&] (int v) { sum += v; }));
+    EXPECT_FALSE(c.collect(bad, [&] (int v) { sum += v; }));
+    EXPECT_EQ(sum, 42);
+    EXPECT_TRUE(c.collect(expected<void, int>()));
+    EXPECT_FALSE(c.collect(expected<void, int>(make_unexpected(2))));
+    unsigned sunk = 0;
+    const expected<void, int> v;
+    EXPECT_TRUE(c.collect(v, [&] { ++sunk; }));
+    EXPECT_EQ(sunk, 1u);
+    auto result = c.finish();
+    EXPECT_TRUE((result.error().errors == std::vector<int> { 1, 2 }));
+}
+
+TEST(WTF_ExpectedCollector, no_allocation_per_item)
+{
+    struct Tag;
+    typedef Instrumented<Tag> Error;
+    expected_collector<int, 16> c;
+    std::size_t before = allocationCount();
+    for (int i = 0; i < 100000; ++i)
+        c.collect(i % 2 ? expected<int, int>(i) : expected<int, int>(make_unexpected(i)), [] (int) { });
+    EXPECT_EQ(allocationCount(), before);
+    EXPECT_EQ(c.size(), 16u);
+    EXPECT_EQ(c.dropped(), 50000u - 16u);
+
+    expected_collector<Error, 2> m;
+    m.record(Error(1));
+    m.record(Error(2));
+    OperationCounts counts = countOperations([&] {
+        m.record(Error(3));
+        auto result = m.finish();
+        EXPECT_EQ(result.error().errors.size(), 2u);
+    });
+    // Error(3) itself, a vector allocation, and one move per retained error; nothing is copied.
+    EXPECT_EQ(counts.copies, 0u);
+    EXPECT_EQ(counts.moves, 2u);
+    EXPECT_EQ(counts.constructions, 1u);
+    EXPECT_EQ(counts.destructions, 5u);
+    EXPECT_EQ(counts.allocations, 2u);
+}
+
+TEST(WTF_ExpectedCollector, move_only_errors)
+{
+    expected_collector<std::unique_ptr<int>, 2> c;
+    for (int i = 0; i < 3; ++i)
+        c.collect(expected<void, std::unique_ptr<int>>(make_unexpected(std::make_unique<int>(i))));
+    auto result = c.finish();
+    EXPECT_EQ(result.error().errors.size(), 2u);
+    EXPECT_EQ(*result.error().errors[1], 1);
+    EXPECT_EQ(result.error().dropped, 1u);
+}
+
+#if WTF_EXPECTED_EXCEPTIONS
+// Counts live instances. Its copy throws while failCopies is set.
+struct FailingCopy {
+    static int live;
+    static bool failCopies;
+    int v;
+    explicit FailingCopy(int v) : v(v) { ++live; }
+    FailingCopy(const FailingCopy& o)
+        : v(o.v)
+    {
+        if (failCopies)
+            throw std::runtime_error("copy");
+        ++live;
+    }
+    ~FailingCopy() { --live; }
+};
+int FailingCopy::live;
+bool FailingCopy::failCopies;
+
+TEST(WTF_ExpectedCollector, throwing_copy)
+{
+    // An error whose copy throws isn't counted, so nothing destroys it later.
+    {
+        expected_collector<FailingCopy, 4> c;
+        FailingCopy error(1);
+        c.record(error);
+        FailingCopy::failCopies = true;
+        bool threw = false;
+        try {
+            c.record(error);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        FailingCopy::failCopies = false;
+        EXPECT_TRUE(threw);
+        EXPECT_EQ(c.size(), 1u);
+        EXPECT_EQ(FailingCopy::live, 2);
+    }
+    EXPECT_EQ(FailingCopy::live, 0);
+}
+#endif
+
+TEST(WTF_ExpectedCollector, merge)
+{
+    expected_collector<int, 3> a;
+    expected_collector<int, 8> b;
+    a.record(1);
+    b.record(2);
+    b.record(3);
+    b.record(4);
+    a.merge(std::move(b));
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(a.size(), 3u);
+    EXPECT_EQ(a.dropped(), 1u);
+    EXPECT_TRUE((a.finish().error().errors == std::vector<int> { 1, 2, 3 }));
+}
+
+TEST(WTF_ExpectedCollector, sharded)
+{
+    constexpr unsigned workers = 4;
+    constexpr int perWorker = 10000;
+    sharded_expected_collector<int, 8> c(workers);
+    EXPECT_EQ(c.shard_count(), workers);
+    std::vector<long long> sums(workers);
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w) {
+        threads.emplace_back([&c, &sums, w] {
+            auto& shard = c.shard(w);
+            for (int i = 0; i < perWorker; ++i) {
+                int record = static_cast<int>(w) * perWorker + i;
+                shard.collect(record % 100 ? expected<int, int>(record) : expected<int, int>(make_unexpected(record)), [&] (int v) { sums[w] += v; });
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    long long total = 0;
+    for (long long sum : sums)
+        total += sum;
+    long long expectedTotal = 0;
+    for (int record = 0; record < static_cast<int>(workers) * perWorker; ++record)
+        expectedTotal += record % 100 ? record : 0;
+    EXPECT_EQ(total, expectedTotal);
+
+    auto result = c.finish();
+    EXPECT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().count(), workers * perWorker / 100u);
+    EXPECT_EQ(result.error().errors.size(), workers * 8u);
+    EXPECT_EQ(result.error().errors[0], 0);
+    EXPECT_EQ(result.error().errors[8], perWorker);
+    EXPECT_TRUE(c.shard(0).empty());
+    EXPECT_TRUE(c.finish().has_value());
+}
+
+} // namespace TestWebKitAPI
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "Instrumented.h"
+
+#include <wtf/ExpectedErrors.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <variant>
+
+namespace TestWebKitAPI {
+
+enum class ParseError : char { Syntax, Overflow };
+enum class IOError : short { NotFound, Denied };
+struct Timeout {
+    long milliseconds;
+    bool operator==(const Timeout& o) const { return milliseconds == o.milliseconds; }
+};
+
+typedef expected<int, errors<ParseError, IOError, Timeout>> Result;
+
+// One tag for the value and every error, instead of a has-value flag next to a variant index.
+static_assert(sizeof(Result) == 2 * sizeof(long), "");
+static_assert(sizeof(Result) < sizeof(expected<int, std::variant<ParseError, IOError, Timeout>>), "");
+static_assert(sizeof(expected<char, errors<ParseError, IOError>>) == 2 * sizeof(short), "");
+
+static_assert(std::is_trivially_copy_constructible<Result>::value, "");
+static_assert(std::is_trivially_move_constructible<Result>::value, "");
+static_assert(std::is_trivially_destructible<Result>::value, "");
+static_assert(std::is_trivially_destructible<expected<void, errors<ParseError, IOError>>>::value, "");
+static_assert(!std::is_trivially_destructible<expected<int, errors<ParseError, std::string>>>::value, "");
+static_assert(std::is_nothrow_move_constructible<expected<std::string, errors<ParseError, std::string>>>::value, "");
+static_assert(!std::is_copy_constructible<expected<int, errors<ParseError, std::unique_ptr<int>>>>::value, "");
+static_assert(std::is_move_constructible<expected<int, errors<ParseError, std::unique_ptr<int>>>>::value, "");
+static_assert(!std::is_copy_assignable<expected<int, errors<ParseError, std::unique_ptr<int>>>>::value, "");
+static_assert(!std::is_copy_assignable<expected<void, errors<ParseError, std::unique_ptr<int>>>>::value, "");
+static_assert(std::is_move_assignable<expected<int, errors<ParseError, std::unique_ptr<int>>>>::value, "");
+static_assert(!std::is_assignable<expected<int, errors<ParseError, IOError>>&, std::string>::value, "");
+
+static_assert(Result::error_count == 3, "");
+static_assert(Result::can_hold_error<IOError>, "");
+static_assert(!Result::can_hold_error<int>, "");
+
+constexpr Result constexprValue = 42;
+constexpr Result constexprError = make_unexpected(IOError::Denied);
+static_assert(constexprValue.has_value() && *constexprValue == 42, "");
+static_assert(!constexprError && constexprError.error_index() == 1, "");
+static_assert(constexprError.holds_error<IOError>() && constexprError.error<IOError>() == IOError::Denied, "");
+
+static expected<int, ParseError> parse(const std::string& s)
+{
+    if (s.empty())
+        return make_unexpected(ParseError::Syntax);
+    return static_cast<int>(s.size());
+}
+
+static Result load(const std::string& path)
+{
+    if (path == "missing")
+        return make_unexpected(IOError::NotFound);
+    if (path == "slow")
+        return make_unexpected(Timeout { 500 });
+    return parse(path == "empty" ? std::string() : path);
+}
+
+TEST(WTF_ExpectedErrors, alternatives)
+{
+    Result value = load("abc");
+    EXPECT_TRUE(value.has_value());
+    EXPECT_EQ(value.value(), 3);
+    EXPECT_EQ(value.value_or(7), 3);
+
+    Result missing = load("missing");
+    EXPECT_FALSE(missing);
+    EXPECT_EQ(missing.error_index(), 1u);
+    EXPECT_TRUE(missing.holds_error<IOError>());
+    EXPECT_FALSE(missing.holds_error<ParseError>());
+    EXPECT_EQ(missing.error<IOError>(), IOError::NotFound);
+    EXPECT_EQ(missing.value_or(7), 7);
+
+    Result empty = load("empty");
+    EXPECT_TRUE(empty.holds_error<ParseError>());
+    EXPECT_EQ(empty.error_index(), 0u);
+
+    Result slow = load("slow");
+    EXPECT_EQ(slow.error<Timeout>().milliseconds, 500);
+    EXPECT_EQ(slow.error_index(), 2u);
+}
+
+struct Describe {
+    std::string operator()(int v) const { return "value " + std::to_string(v); }
+    std::string operator()(ParseError) const { return "parse"; }
+    std::string operator()(IOError e) const { return e == IOError::NotFound ? "not found" : "denied"; }
+    std::string operator()(const Timeout& t) const { return "timeout " + std::to_string(t.milliseconds); }
+};
+
+TEST(WTF_ExpectedErrors, visit)
+{
+    EXPECT_EQ(load("abcd").visit(Describe()), "value 4");
+    EXPECT_EQ(load("missing").visit(Describe()), "not found");
+    EXPECT_EQ(load("slow").visit_error(Describe()), "timeout 500");
+    EXPECT_EQ(load("empty").visit_error([](const auto& e) { return sizeof(e); }), sizeof(ParseError));
+
+    expected<void, errors<ParseError, std::string>> failed = make_unexpected(std::string("disk"));
+    std::string moved = std::move(failed).visit_error([](auto&& e) -> std::string {
+        if constexpr (std::is_same<std::decay_t<decltype(e)>, std::string>::value)
+            return std::move(e);
+        else
+            return "parse";
+    });
+    EXPECT_EQ(moved, "disk");
+}
+
+TEST(WTF_ExpectedErrors, widening)
+{
+    expected<int, ParseError> narrow = make_unexpected(ParseError::Overflow);
+    Result wide = narrow;
+    EXPECT_TRUE(wide.holds_error<ParseError>());
+    EXPECT_EQ(wide.error<ParseError>(), ParseError::Overflow);
+    wide = expected<int, ParseError>(5);
+    EXPECT_EQ(wide, 5);
+
+    // The source's errors can be in any order.
+    expected<int, errors<Timeout, IOError>> reordered = make_unexpected(Timeout { 9 });
+    wide = reordered;
+    EXPECT_TRUE(wide.holds_error<Timeout>());
+    EXPECT_EQ(wide.error_index(), 2u);
+    reordered = make_unexpected(IOError::Denied);
+    wide = std::move(reordered);
+    EXPECT_EQ(wide, make_unexpected(IOError::Denied));
+
+    expected<void, errors<std::string>> narrowVoid = make_unexpected(std::string("bad"));
+    expected<void, errors<ParseError, std::string>> wideVoid = std::move(narrowVoid);
+    EXPECT_EQ(wideVoid.error<std::string>(), "bad");
+    expected<void, ParseError> single;
+    wideVoid = single;
+    EXPECT_TRUE(wideVoid.has_value());
+
+    static_assert(std::is_constructible<Result, expected<int, IOError>>::value, "");
+    static_assert(!std::is_constructible<expected<int, IOError>, Result>::value, "");
+    static_assert(!std::is_constructible<expected<int, errors<ParseError>>, Result>::value, "");
+}
+
+TEST(WTF_ExpectedErrors, comparison_and_hash)
+{
+    EXPECT_EQ(load("abc"), load("xyz"));
+    EXPECT_NE(load("abc"), load("ab"));
+    EXPECT_EQ(load("missing"), load("missing"));
+    EXPECT_NE(load("missing"), load("empty"));
+    EXPECT_NE(load("missing"), load("abc"));
+    EXPECT_EQ(load("slow"), make_unexpected(Timeout { 500 }));
+    EXPECT_NE(make_unexpected(ParseError::Syntax), load("slow"));
+
+    expected<void, errors<ParseError, IOError>> ok;
+    expected<void, errors<ParseError, IOError>> bad = make_unexpected(IOError::Denied);
+    EXPECT_EQ(ok, (expected<void, errors<ParseError, IOError>>()));
+    EXPECT_NE(ok, bad);
+
+    typedef expected<int, errors<char, int>> Ambiguous;
+    std::unordered_set<Ambiguous> set;
+    set.insert(Ambiguous(1));
+    set.insert(Ambiguous(make_unexpected(1)));
+    set.insert(Ambiguous(make_unexpected('a')));
+    set.insert(Ambiguous(make_unexpected(1)));
+    EXPECT_EQ(set.size(), 3u);
+    EXPECT_EQ(set.count(Ambiguous(make_unexpected(1))), 1u);
+}
+
+TEST(WTF_ExpectedErrors, ordering)
+{
+    // Values order before errors, and errors by their position in errors<...> before their own order.
+    typedef expected<int, errors<ParseError, IOError>> Ordered;
+    Ordered one = 1;
+    Ordered two = 2;
+    Ordered syntax = make_unexpected(ParseError::Syntax);
+    Ordered overflow = make_unexpected(ParseError::Overflow);
+    Ordered notFound = make_unexpected(IOError::NotFound);
+    EXPECT_TRUE(one < two);
+    EXPECT_TRUE(two < syntax);
+    EXPECT_TRUE(syntax < overflow);
+    EXPECT_TRUE(overflow < notFound);
+    EXPECT_FALSE(notFound < syntax);
+    EXPECT_TRUE(notFound > overflow);
+    EXPECT_TRUE(syntax <= syntax);
+    EXPECT_TRUE(notFound >= one);
+
+    typedef expected<void, errors<ParseError, IOError>> OrderedVoid;
+    OrderedVoid ok;
+    OrderedVoid denied = make_unexpected(IOError::Denied);
+    EXPECT_TRUE(ok < denied);
+    EXPECT_TRUE(OrderedVoid(make_unexpected(ParseError::Overflow)) < denied);
+    EXPECT_FALSE(ok < ok);
+    EXPECT_TRUE(denied >= ok);
+}
+
+#if WTF_EXPECTED_EXCEPTIONS
+TEST(WTF_ExpectedErrors, value_or_throw)
+{
+    EXPECT_EQ(value_or_throw(load("abc")), 3);
+    const Result missing = load("missing");
+    bool caught = false;
+    try {
+        value_or_throw(missing);
+    } catch (const WTF::bad_expected_access<IOError>& e) {
+        caught = e.error() == IOError::NotFound;
+    }
+    EXPECT_TRUE(caught);
+
+    caught = false;
+    try {
+        value_or_throw(expected<void, errors<ParseError, Timeout>>(make_unexpected(Timeout { 5 })));
+    } catch (const WTF::bad_expected_access<Timeout>& e) {
+        caught = e.error().milliseconds == 5;
+    }
+    EXPECT_TRUE(caught);
+}
+#endif
+
+struct ErrorTag { };
+struct ValueTag { };
+
+TEST(WTF_ExpectedErrors, non_trivial_alternatives)
+{
+    typedef expected<Instrumented<ValueTag>, errors<ParseError, Instrumented<ErrorTag>>> Counted;
+    OperationCounts counts = countOperations([] {
+        Counted value = Instrumented<ValueTag>(1);
+        Counted error = make_unexpected(Instrumented<ErrorTag>(2));
+        Counted copy = error;
+        value.swap(error);
+        EXPECT_EQ(value.error<Instrumented<ErrorTag>>().value(), 2);
+        EXPECT_EQ(error.value().value(), 1);
+        copy = Counted(make_unexpected(ParseError::Syntax));
+        EXPECT_TRUE(copy.holds_error<ParseError>());
+        copy = value;
+        EXPECT_EQ(copy, value);
+    });
+    EXPECT_EQ(counts.constructions + counts.copies + counts.moves, counts.destructions);
+    EXPECT_EQ(counts.allocations, 4u);
+
+    expected<int, errors<ParseError, std::unique_ptr<int>>> owner = make_unexpected(std::make_unique<int>(7));
+    auto moved = std::move(owner);
+    EXPECT_EQ(*moved.error<std::unique_ptr<int>>(), 7);
+    std::unique_ptr<int> taken = std::move(moved).error<std::unique_ptr<int>>();
+    EXPECT_EQ(*taken, 7);
+}
+
+#if WTF_EXPECTED_EXCEPTIONS
+// Counts live instances. Its move throws while failMoves is set.
+struct FailingMove {
+    static int live;
+    static bool failMoves;
+    int v;
+    explicit FailingMove(int v) : v(v) { ++live; }
+    FailingMove(const FailingMove& o) : v(o.v) { ++live; }
+    FailingMove(FailingMove&& o)
+        : v(o.v)
+    {
+        if (failMoves)
+            throw std::runtime_error("move");
+        ++live;
+    }
+    FailingMove& operator=(const FailingMove&) = default;
+    FailingMove& operator=(FailingMove&&) = default;
+    ~FailingMove() { --live; }
+};
+int FailingMove::live;
+bool FailingMove::failMoves;
+
+template <class E> static bool swapThrows(E& a, E& b)
+{
+    try {
+        a.swap(b);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+TEST(WTF_ExpectedErrors, swap_with_throwing_move)
+{
+    // Whichever alternative's move throws, both keep what they held and nothing is destroyed twice.
+    {
+        typedef expected<FailingMove, errors<ParseError, std::string>> E;
+        E value = FailingMove(1);
+        E error = make_unexpected(std::string("x"));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        EXPECT_TRUE(swapThrows(error, value));
+        FailingMove::failMoves = false;
+        EXPECT_EQ(value->v, 1);
+        EXPECT_EQ(error.error<std::string>(), "x");
+        EXPECT_FALSE(swapThrows(value, error));
+        EXPECT_EQ(value.error<std::string>(), "x");
+        EXPECT_EQ(error->v, 1);
+    }
+    {
+        typedef expected<void, errors<ParseError, FailingMove>> V;
+        V value;
+        V error = make_unexpected(FailingMove(2));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        EXPECT_TRUE(swapThrows(error, value));
+        FailingMove::failMoves = false;
+        EXPECT_TRUE(value.has_value());
+        EXPECT_EQ(error.error<FailingMove>().v, 2);
+        EXPECT_FALSE(swapThrows(value, error));
+        EXPECT_EQ(value.error<FailingMove>().v, 2);
+        EXPECT_TRUE(error.has_value());
+    }
+    {
+        typedef expected<FailingMove, errors<ParseError, FailingMove>> E;
+        E value = FailingMove(1);
+        E error = make_unexpected(FailingMove(2));
+        FailingMove::failMoves = true;
+        EXPECT_TRUE(swapThrows(value, error));
+        FailingMove::failMoves = false;
+        EXPECT_EQ(value->v, 1);
+        EXPECT_EQ(error.error<FailingMove>().v, 2);
+    }
+    EXPECT_EQ(FailingMove::live, 0);
+}
+#endif
+
+} // namespace TestWebKitAPI
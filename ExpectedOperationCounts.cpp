@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include "Instrumented.h"
+
+#include <wtf/Expected.h>
+
+#include <cstdio>
+
+namespace TestWebKitAPI {
+
+namespace {
+
+struct ValueTag;
+struct ErrorTag;
+typedef Instrumented<ValueTag> Value;
+typedef Instrumented<ErrorTag> Error;
+typedef expected<Value, Error> Ex;
+typedef expected<void, Error> Vx;
+
+OperationCounts ops(unsigned constructions, unsigned copies, unsigned moves, unsigned copyAssignments, unsigned moveAssignments, unsigned destructions, std::size_t allocations)
+{
+    return { constructions, copies, moves, copyAssignments, moveAssignments, destructions, allocations };
+}
+
+const OperationCounts none = ops(0, 0, 0, 0, 0, 0, 0);
+
+// Each row sets up its operands outside of countOperations, so only the operation itself is counted.
+struct Row {
+    const char* name;
+    OperationCounts (*measure)();
+    OperationCounts expected;
+};
+
+void check(const Row* begin, const Row* end)
+{
+    for (const Row* row = begin; row != end; ++row) {
+        OperationCounts actual = row->measure();
+        if (actual != row->expected) {
+            std::fprintf(stderr, "%s: expected %u/%u/%u/%u/%u/%u/%zu, got %u/%u/%u/%u/%u/%u/%zu (constructions/copies/moves/copy assignments/move assignments/destructions/allocations)\n", row->name,
+                row->expected.constructions, row->expected.copies, row->expected.moves, row->expected.copyAssignments, row->expected.moveAssignments, row->expected.destructions, row->expected.allocations,
+                actual.constructions, actual.copies, actual.moves, actual.copyAssignments, actual.moveAssignments, actual.destructions, actual.allocations);
+        }
+        EXPECT_EQ(actual, row->expected);
+    }
+}
+
+template <size_t N> void check(const Row (&rows)[N]) { check(rows, rows + N); }
+
+} // anonymous namespace
+
+TEST(WTF_Expected, operation_counts)
+{
+    static const Row rows[] = {
+        { "expected()", [] { return countOperations([] { Ex e; }); }, ops(1, 0, 0, 0, 0, 1, 1) },
+        { "expected(const T&)", [] { Value v(1); return countOperations([&] { Ex e(v); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected(T&&)", [] { Value v(1); return countOperations([&] { Ex e(std::move(v)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "expected(const unexpected_type<E>&)", [] { auto u = make_unexpected(Error(1)); return countOperations([&] { Ex e(u); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected(unexpected_type<E>&&)", [] { auto u = make_unexpected(Error(1)); return countOperations([&] { Ex e(std::move(u)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        // The converting constructors build the error in place. Error's int constructor is explicit, so they are too.
+        { "explicit expected(const unexpected_type<Err>&)", [] { auto u = make_unexpected(1); return countOperations([&] { Ex e(u); }); }, ops(1, 0, 0, 0, 0, 1, 1) },
+        { "explicit expected(unexpected_type<Err>&&)", [] { auto u = make_unexpected(1); return countOperations([&] { Ex e(std::move(u)); }); }, ops(1, 0, 0, 0, 0, 1, 1) },
+        { "expected(const expected&), value", [] { Ex e(Value(1)); return countOperations([&] { Ex c(e); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected(const expected&), error", [] { Ex e(make_unexpected(Error(1))); return countOperations([&] { Ex c(e); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected(expected&&), value", [] { Ex e(Value(1)); return countOperations([&] { Ex c(std::move(e)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "expected(expected&&), error", [] { Ex e(make_unexpected(Error(1))); return countOperations([&] { Ex c(std::move(e)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+
+        // Assignment is copy-and-swap: construct a temporary, swap it in, destroy it.
+        { "operator=(const expected&), value = value", [] { Ex a(Value(1)); Ex b(Value(2)); return countOperations([&] { a = b; }); }, ops(0, 1, 1, 0, 2, 2, 1) },
+        { "operator=(const expected&), value = error", [] { Ex a(Value(1)); Ex b(make_unexpected(Error(2))); return countOperations([&] { a = b; }); }, ops(0, 1, 3, 0, 0, 4, 1) },
+        { "operator=(const expected&), error = value", [] { Ex a(make_unexpected(Error(1))); Ex b(Value(2)); return countOperations([&] { a = b; }); }, ops(0, 1, 3, 0, 0, 4, 1) },
+        { "operator=(const expected&), error = error", [] { Ex a(make_unexpected(Error(1))); Ex b(make_unexpected(Error(2))); return countOperations([&] { a = b; }); }, ops(0, 1, 1, 0, 2, 2, 1) },
+        { "operator=(expected&&), value = value", [] { Ex a(Value(1)); Ex b(Value(2)); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 2, 0, 2, 2, 0) },
+        { "operator=(expected&&), value = error", [] { Ex a(Value(1)); Ex b(make_unexpected(Error(2))); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 4, 0, 0, 4, 0) },
+        { "operator=(expected&&), error = value", [] { Ex a(make_unexpected(Error(1))); Ex b(Value(2)); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 4, 0, 0, 4, 0) },
+        { "operator=(expected&&), error = error", [] { Ex a(make_unexpected(Error(1))); Ex b(make_unexpected(Error(2))); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 2, 0, 2, 2, 0) },
+        { "operator=(U&&), const T&", [] { Ex a(Value(1)); const Value v(2); return countOperations([&] { a = v; }); }, ops(0, 1, 1, 0, 2, 2, 1) },
+        { "operator=(U&&), T&&", [] { Ex a(Value(1)); Value v(2); return countOperations([&] { a = std::move(v); }); }, ops(0, 0, 2, 0, 2, 2, 0) },
+        { "operator=(const unexpected_type<E>&)", [] { Ex a(Value(1)); auto u = make_unexpected(Error(2)); return countOperations([&] { a = u; }); }, ops(0, 1, 3, 0, 0, 4, 1) },
+        { "operator=(unexpected_type<E>&&)", [] { Ex a(Value(1)); auto u = make_unexpected(Error(2)); return countOperations([&] { a = std::move(u); }); }, ops(0, 0, 4, 0, 0, 4, 0) },
+
+        { "swap, value and value", [] { Ex a(Value(1)); Ex b(Value(2)); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 1, 0, 2, 1, 0) },
+        { "swap, value and error", [] { Ex a(Value(1)); Ex b(make_unexpected(Error(2))); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 3, 0, 0, 3, 0) },
+        { "swap, error and value", [] { Ex a(make_unexpected(Error(1))); Ex b(Value(2)); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 3, 0, 0, 3, 0) },
+        { "swap, error and error", [] { Ex a(make_unexpected(Error(1))); Ex b(make_unexpected(Error(2))); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 1, 0, 2, 1, 0) },
+
+        { "relational operators, expected and expected", [] {
+            Ex a(Value(1)); Ex b(Value(2)); Ex u(make_unexpected(Error(1)));
+            return countOperations([&] {
+                EXPECT_TRUE(a != b && a < b && b > a && a <= b && b >= a && !(a == b));
+                EXPECT_TRUE(a != u && a < u && u > a && a <= u && u >= a && !(a == u));
+            });
+        }, none },
+        { "relational operators, expected and T", [] {
+            Ex a(Value(1)); Ex u(make_unexpected(Error(1))); Value v(2);
+            return countOperations([&] {
+                EXPECT_TRUE(a != v && a < v && !(a > v) && a <= v && !(a >= v) && !(a == v));
+                EXPECT_TRUE(v != a && !(v < a) && v > a && !(v <= a) && v >= a && !(v == a));
+                EXPECT_TRUE(u != v && !(u < v) && u > v && !(u <= v) && u >= v && !(u == v));
+                EXPECT_TRUE(v != u && v < u && !(v > u) && v <= u && !(v >= u) && !(v == u));
+            });
+        }, none },
+        { "relational operators, expected and unexpected_type<E>", [] {
+            Ex a(Value(1)); Ex u(make_unexpected(Error(1))); auto e = make_unexpected(Error(2));
+            return countOperations([&] {
+                EXPECT_TRUE(a != e && a < e && !(a > e) && a <= e && !(a >= e) && !(a == e));
+                EXPECT_TRUE(e != a && !(e < a) && e > a && !(e <= a) && e >= a && !(e == a));
+                EXPECT_TRUE(u != e && u < e && !(u > e) && u <= e && !(u >= e) && !(u == e));
+                EXPECT_TRUE(e != u && !(e < u) && e > u && !(e <= u) && e >= u && !(e == u));
+            });
+        }, none },
+        { "std::hash", [] {
+            Ex a(Value(1)); Ex u(make_unexpected(Error(1)));
+            return countOperations([&] {
+                EXPECT_EQ(std::hash<Ex>{ }(a), std::hash<Value>{ }(*a));
+                EXPECT_EQ(std::hash<Ex>{ }(u), std::hash<Error>{ }(u.error()));
+            });
+        }, none },
+
+        { "accessors", [] {
+            Ex a(Value(1)); Ex u(make_unexpected(Error(2)));
+            return countOperations([&] { EXPECT_TRUE(a.has_value() && a.value().value() == 1 && (*a).value() == 1 && a->value() == 1 && !u && u.error().value() == 2); });
+        }, none },
+        { "get_unexpected()", [] { Ex u(make_unexpected(Error(1))); return countOperations([&] { auto e = u.get_unexpected(); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "value_or(U&&) const&, value", [] { const Ex a(Value(1)); Value v(2); return countOperations([&] { Value r = a.value_or(std::move(v)); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "value_or(U&&) const&, error", [] { const Ex u(make_unexpected(Error(1))); Value v(2); return countOperations([&] { Value r = u.value_or(std::move(v)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "value_or(U&&) &&, value", [] { Ex a(Value(1)); Value v(2); return countOperations([&] { Value r = std::move(a).value_or(std::move(v)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "value_or(U&&) &&, error", [] { Ex u(make_unexpected(Error(1))); Value v(2); return countOperations([&] { Value r = std::move(u).value_or(std::move(v)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "value_or(U&&) converting, error", [] { const Ex u(make_unexpected(Error(1))); return countOperations([&] { Value r = u.value_or(2); }); }, ops(1, 0, 0, 0, 0, 1, 1) },
+    };
+    check(rows);
+}
+
+TEST(WTF_Expected, operation_counts_void)
+{
+    static const Row rows[] = {
+        { "expected<void>()", [] { return countOperations([] { Vx e; }); }, none },
+        { "expected<void>(const unexpected_type<E>&)", [] { auto u = make_unexpected(Error(1)); return countOperations([&] { Vx e(u); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected<void>(unexpected_type<E>&&)", [] { auto u = make_unexpected(Error(1)); return countOperations([&] { Vx e(std::move(u)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "expected<void>(const expected&), value", [] { Vx e; return countOperations([&] { Vx c(e); }); }, none },
+        { "expected<void>(const expected&), error", [] { Vx e(make_unexpected(Error(1))); return countOperations([&] { Vx c(e); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+        { "expected<void>(expected&&), value", [] { Vx e; return countOperations([&] { Vx c(std::move(e)); }); }, none },
+        { "expected<void>(expected&&), error", [] { Vx e(make_unexpected(Error(1))); return countOperations([&] { Vx c(std::move(e)); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+
+        { "expected<void>::operator=(const expected&), value = value", [] { Vx a; Vx b; return countOperations([&] { a = b; }); }, none },
+        { "expected<void>::operator=(const expected&), value = error", [] { Vx a; Vx b(make_unexpected(Error(2))); return countOperations([&] { a = b; }); }, ops(0, 1, 1, 0, 0, 1, 1) },
+        { "expected<void>::operator=(const expected&), error = value", [] { Vx a(make_unexpected(Error(1))); Vx b; return countOperations([&] { a = b; }); }, ops(0, 0, 1, 0, 0, 2, 0) },
+        { "expected<void>::operator=(const expected&), error = error", [] { Vx a(make_unexpected(Error(1))); Vx b(make_unexpected(Error(2))); return countOperations([&] { a = b; }); }, ops(0, 1, 1, 0, 2, 2, 1) },
+        { "expected<void>::operator=(expected&&), value = value", [] { Vx a; Vx b; return countOperations([&] { a = std::move(b); }); }, none },
+        { "expected<void>::operator=(expected&&), value = error", [] { Vx a; Vx b(make_unexpected(Error(2))); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 2, 0, 0, 1, 0) },
+        { "expected<void>::operator=(expected&&), error = value", [] { Vx a(make_unexpected(Error(1))); Vx b; return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 1, 0, 0, 2, 0) },
+        { "expected<void>::operator=(expected&&), error = error", [] { Vx a(make_unexpected(Error(1))); Vx b(make_unexpected(Error(2))); return countOperations([&] { a = std::move(b); }); }, ops(0, 0, 2, 0, 2, 2, 0) },
+        { "expected<void>::operator=(const unexpected_type<E>&)", [] { Vx a; auto u = make_unexpected(Error(2)); return countOperations([&] { a = u; }); }, ops(0, 1, 1, 0, 0, 1, 1) },
+        { "expected<void>::operator=(unexpected_type<E>&&)", [] { Vx a; auto u = make_unexpected(Error(2)); return countOperations([&] { a = std::move(u); }); }, ops(0, 0, 2, 0, 0, 1, 0) },
+
+        { "expected<void> swap, value and value", [] { Vx a; Vx b; return countOperations([&] { swap(a, b); }); }, none },
+        { "expected<void> swap, value and error", [] { Vx a; Vx b(make_unexpected(Error(2))); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "expected<void> swap, error and value", [] { Vx a(make_unexpected(Error(1))); Vx b; return countOperations([&] { swap(a, b); }); }, ops(0, 0, 1, 0, 0, 1, 0) },
+        { "expected<void> swap, error and error", [] { Vx a(make_unexpected(Error(1))); Vx b(make_unexpected(Error(2))); return countOperations([&] { swap(a, b); }); }, ops(0, 0, 1, 0, 2, 1, 0) },
+
+        { "expected<void> relational operators", [] {
+            Vx a; Vx u(make_unexpected(Error(1))); auto e = make_unexpected(Error(2));
+            return countOperations([&] {
+                EXPECT_TRUE(a != u && a < u && u > a && a <= u && u >= a && !(a == u));
+                EXPECT_TRUE(a != e && a < e && e > a && u < e && u != e && !(u == e));
+            });
+        }, none },
+        { "expected<void> std::hash", [] {
+            Vx a; Vx u(make_unexpected(Error(1)));
+            return countOperations([&] {
+                EXPECT_EQ(std::hash<Vx>{ }(a), 0u);
+                EXPECT_EQ(std::hash<Vx>{ }(u), std::hash<Error>{ }(u.error()));
+            });
+        }, none },
+        { "expected<void> get_unexpected()", [] { Vx u(make_unexpected(Error(1))); return countOperations([&] { auto e = u.get_unexpected(); }); }, ops(0, 1, 0, 0, 0, 1, 1) },
+    };
+    check(rows);
+}
+
+} // namespace TestWebKitAPI
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Payload types which count every special member call and heap allocation, so that tests can assert
+// exactly how much work an operation does instead of merely that it produces the right value.
+
+#ifndef Instrumented_h
+#define Instrumented_h
+
+#include "Test.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace TestWebKitAPI {
+
+struct OperationCounts {
+    unsigned constructions;
+    unsigned copies;
+    unsigned moves;
+    unsigned copyAssignments;
+    unsigned moveAssignments;
+    unsigned destructions;
+    std::size_t allocations;
+
+    bool operator==(const OperationCounts& o) const
+    {
+        return constructions == o.constructions && copies == o.copies && moves == o.moves
+            && copyAssignments == o.copyAssignments && moveAssignments == o.moveAssignments
+            && destructions == o.destructions && allocations == o.allocations;
+    }
+    bool operator!=(const OperationCounts& o) const { return !(*this == o); }
+};
+
+inline OperationCounts& operationCounts()
+{
+    static OperationCounts counts;
+    return counts;
+}
+
+// Counts the operations performed while f runs, including destruction of anything f's body owns.
+template <class F> OperationCounts countOperations(F f)
+{
+    operationCounts() = OperationCounts();
+    std::size_t allocationsBefore = allocationCount();
+    f();
+    OperationCounts counts = operationCounts();
+    counts.allocations = allocationCount() - allocationsBefore;
+    return counts;
+}
+
+// Owns a heap-allocated int so that a copy costs an allocation, just like the strings and vectors
+// which make hidden copies expensive in practice. Moved-from instances compare as 0. The allocation
+// calls operator new directly because the compiler may elide a new-expression paired with a delete.
+template <class Tag>
+class Instrumented {
+public:
+    Instrumented() : Instrumented(0) { }
+    explicit Instrumented(int v) : p(allocate(v)) { ++operationCounts().constructions; }
+    Instrumented(const Instrumented& o) : p(allocate(o.value())) { ++operationCounts().copies; }
+    Instrumented(Instrumented&& o) noexcept : p(o.p) { o.p = nullptr; ++operationCounts().moves; }
+    Instrumented& operator=(const Instrumented& o)
+    {
+        ++operationCounts().copyAssignments;
+        if (this != &o) {
+            deallocate(p);
+            p = allocate(o.value());
+        }
+        return *this;
+    }
+    Instrumented& operator=(Instrumented&& o) noexcept
+    {
+        ++operationCounts().moveAssignments;
+        if (this != &o) {
+            deallocate(p);
+            p = o.p;
+            o.p = nullptr;
+        }
+        return *this;
+    }
+    ~Instrumented() { deallocate(p); ++operationCounts().destructions; }
+
+    int value() const { return p ? *p : 0; }
+
+private:
+    static int* allocate(int v) { return ::new (::operator new(sizeof(int))) int(v); }
+    static void deallocate(int* p) { ::operator delete(p); }
+
+    int* p;
+};
+
+template <class Tag> bool operator==(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() == y.value(); }
+template <class Tag> bool operator!=(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() != y.value(); }
+template <class Tag> bool operator<(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() < y.value(); }
+template <class Tag> bool operator>(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() > y.value(); }
+template <class Tag> bool operator<=(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() <= y.value(); }
+template <class Tag> bool operator>=(const Instrumented<Tag>& x, const Instrumented<Tag>& y) { return x.value() >= y.value(); }
+
+} // namespace TestWebKitAPI
+
+namespace std {
+
+template <class Tag> struct hash<TestWebKitAPI::Instrumented<Tag>> {
+    std::size_t operator()(const TestWebKitAPI::Instrumented<Tag>& i) const { return std::hash<int>{ }(i.value()); }
+};
+
+}
+
+#endif
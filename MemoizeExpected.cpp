@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <wtf/MemoizeExpected.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TestWebKitAPI {
+
+struct ManualClock {
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<ManualClock> time_point;
+    static constexpr bool is_steady = true;
+    static time_point now() { return current; }
+    static void advance(duration d) { current += d; }
+    static time_point current;
+};
+
+ManualClock::time_point ManualClock::current;
+
+static expected<int, std::string> checkedSquare(int i)
+{
+    if (i < 0)
+        return make_unexpected(std::string("negative"));
+    return i * i;
+}
+
+TEST(WTF_MemoizeExpected, hits_and_misses)
+{
+    int calls = 0;
+    memoize_expected<int, int, std::string> square([&](const int& i) { ++calls; return checkedSquare(i); });
+    EXPECT_EQ(square(3), 9);
+    EXPECT_EQ(square(3), 9);
+    EXPECT_EQ(square(4), 16);
+    EXPECT_EQ(calls, 2);
+    memoize_statistics stats = square.statistics();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.evictions, 0u);
+    EXPECT_EQ(square.size(), 2u);
+    square.clear();
+    EXPECT_EQ(square.size(), 0u);
+    EXPECT_EQ(square(3), 9);
+    EXPECT_EQ(calls, 3);
+}
+
+TEST(WTF_MemoizeExpected, errors_not_cached_by_default)
+{
+    int calls = 0;
+    memoize_expected<int, int, std::string> square([&](const int& i) { ++calls; return checkedSquare(i); });
+    EXPECT_EQ(square(-1), make_unexpected(std::string("negative")));
+    EXPECT_EQ(square(-1), make_unexpected(std::string("negative")));
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(square.size(), 0u);
+}
+
+TEST(WTF_MemoizeExpected, separate_ttls)
+{
+    int calls = 0;
+    memoize_policy policy;
+    policy.value_ttl = std::chrono::seconds(10);
+    policy.error_ttl = std::chrono::seconds(1);
+    memoize_expected<int, int, std::string, std::hash<int>, ManualClock> square([&](const int& i) { ++calls; return checkedSquare(i); }, policy);
+    EXPECT_EQ(square(2), 4);
+    EXPECT_EQ(square(-2), make_unexpected(std::string("negative")));
+    EXPECT_EQ(calls, 2);
+    ManualClock::advance(std::chrono::milliseconds(500));
+    EXPECT_EQ(square(2), 4);
+    EXPECT_EQ(square(-2), make_unexpected(std::string("negative")));
+    EXPECT_EQ(calls, 2);
+    ManualClock::advance(std::chrono::seconds(1));
+    EXPECT_EQ(square(2), 4);
+    EXPECT_EQ(square(-2), make_unexpected(std::string("negative")));
+    EXPECT_EQ(calls, 3);
+    ManualClock::advance(std::chrono::seconds(10));
+    EXPECT_EQ(square(2), 4);
+    EXPECT_EQ(calls, 4);
+    EXPECT_EQ(square.statistics().expirations, 2u);
+}
+
+TEST(WTF_MemoizeExpected, eviction)
+{
+    memoize_policy policy;
+    policy.capacity = 8;
+    policy.shards = 1;
+    policy.error_ttl = std::chrono::hours(1);
+    memoize_expected<int, int, std::string> square(checkedSquare, policy);
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(square(i), i * i);
+    EXPECT_EQ(square.size(), 8u);
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(square(i), i * i);
+    EXPECT_EQ(square(100), 10000);
+    EXPECT_EQ(square.size(), 8u);
+    EXPECT_EQ(square.statistics().evictions, 1u);
+
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(square(i), i * i);
+    EXPECT_EQ(square.size(), 8u);
+}
+
+TEST(WTF_MemoizeExpected, errors_evicted_first)
+{
+    memoize_policy policy;
+    policy.capacity = 2;
+    policy.shards = 1;
+    policy.error_ttl = std::chrono::hours(1);
+    memoize_expected<int, int, std::string> square(checkedSquare, policy);
+    EXPECT_EQ(square(1), 1);
+    EXPECT_EQ(square(-1), make_unexpected(std::string("negative")));
+    EXPECT_EQ(square(1), 1);
+    EXPECT_EQ(square(-1), make_unexpected(std::string("negative")));
+    EXPECT_EQ(square(2), 4);
+
+    // Both were used, but errors don't get a second chance.
+    EXPECT_EQ(square.statistics().evictions, 1u);
+    EXPECT_EQ(square(1), 1);
+    EXPECT_EQ(square.statistics().hits, 3u);
+    EXPECT_EQ(square(-1), make_unexpected(std::string("negative")));
+    EXPECT_EQ(square.statistics().misses, 4u);
+}
+
+TEST(WTF_MemoizeExpected, shards_spread_keys)
+{
+    // std::hash<int> is the identity, so these keys all share their low bit.
+    memoize_policy policy;
+    policy.capacity = 8;
+    policy.shards = 2;
+    memoize_expected<int, int, std::string> square(checkedSquare, policy);
+    for (int i = 0; i < 16; i += 2)
+        EXPECT_EQ(square(i), i * i);
+    EXPECT_TRUE(square.statistics().evictions < 4u);
+}
+
+TEST(WTF_MemoizeExpected, shrinks_after_overshoot)
+{
+    // Each computation needs the next key's, so all five are in flight at once, past the capacity of 2.
+    memoize_policy policy;
+    policy.capacity = 2;
+    policy.shards = 1;
+    std::function<expected<int, std::string>(const int&)> chain;
+    memoize_expected<int, int, std::string> m([&](const int& i) { return chain(i); }, policy);
+    chain = [&](const int& i) -> expected<int, std::string> {
+        if (i >= 4)
+            return i;
+        auto next = m(i + 1);
+        if (!next)
+            return next;
+        return *next + i;
+    };
+    EXPECT_EQ(m(0), 10);
+    EXPECT_EQ(m.size(), 5u);
+    EXPECT_EQ(m(5), 5);
+    EXPECT_EQ(m.size(), 2u);
+}
+
+TEST(WTF_MemoizeExpected, expected_keys)
+{
+    typedef expected<int, std::string> Key;
+    int calls = 0;
+    memoize_expected<Key, int, std::string> resolve([&](const Key& key) -> expected<int, std::string> {
+        ++calls;
+        if (!key)
+            return make_unexpected(key.error());
+        return *key + 1;
+    });
+    EXPECT_EQ(resolve(Key(1)), 2);
+    EXPECT_EQ(resolve(Key(1)), 2);
+    EXPECT_EQ(resolve(Key(make_unexpected(std::string("bad")))), make_unexpected(std::string("bad")));
+    EXPECT_EQ(calls, 2);
+}
+
+#if WTF_EXPECTED_EXCEPTIONS
+TEST(WTF_MemoizeExpected, throwing_function)
+{
+    int calls = 0;
+    memoize_expected<int, int, std::string> square([&](const int& i) -> expected<int, std::string> {
+        if (!calls++)
+            throw std::runtime_error("transient");
+        return i * i;
+    });
+    bool threw = false;
+    try {
+        square(5);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    EXPECT_TRUE(threw);
+    EXPECT_EQ(square.size(), 0u);
+    EXPECT_EQ(square(5), 25);
+    EXPECT_EQ(calls, 2);
+}
+struct FragileCopy {
+    explicit FragileCopy(int v) : v(v) { }
+    FragileCopy(const FragileCopy& o) : v(o.v)
+    {
+        if (failCopies)
+            throw std::bad_alloc();
+    }
+    FragileCopy(FragileCopy&&) = default;
+    FragileCopy& operator=(const FragileCopy&) = default;
+    FragileCopy& operator=(FragileCopy&&) = default;
+    int v;
+    static bool failCopies;
+};
+
+bool FragileCopy::failCopies;
+
+TEST(WTF_MemoizeExpected, throwing_copy)
+{
+    memoize_expected<int, FragileCopy, std::string> make([](const int& i) -> expected<FragileCopy, std::string> { return FragileCopy(i); });
+    FragileCopy::failCopies = true;
+    bool threw = false;
+    try {
+        make(1);
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    FragileCopy::failCopies = false;
+    EXPECT_TRUE(threw);
+    EXPECT_EQ(make.size(), 0u);
+    EXPECT_EQ(make(1)->v, 1);
+    EXPECT_EQ(make(1)->v, 1);
+    EXPECT_EQ(make.statistics().hits, 1u);
+}
+#endif
+
+TEST(WTF_MemoizeExpected, single_flight)
+{
+    constexpr unsigned threadCount = 8;
+    std::atomic<int> calls { 0 };
+    std::atomic<bool> release { false };
+    memoize_expected<int, int, std::string> slow([&](const int& i) -> expected<int, std::string> {
+        ++calls;
+        while (!release)
+            std::this_thread::yield();
+        return i * 2;
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> correct { 0 };
+    for (unsigned i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&] {
+            if (slow(21) == 42)
+                ++correct;
+        });
+    }
+    while (slow.statistics().misses + slow.statistics().coalesced < threadCount)
+        std::this_thread::yield();
+    release = true;
+    for (std::thread& thread : threads)
+        thread.join();
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(correct.load(), threadCount);
+    memoize_statistics stats = slow.statistics();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.coalesced, threadCount - 1);
+}
+
+TEST(WTF_MemoizeExpected, concurrent)
+{
+    memoize_policy policy;
+    policy.capacity = 64;
+    policy.shards = 4;
+    memoize_expected<int, int, std::string> square(checkedSquare, policy);
+    std::atomic<unsigned> wrong { 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 20000; ++i) {
+                int key = (i * 7 + t) % 200 - 10;
+                if (square(key) != checkedSquare(key))
+                    ++wrong;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    EXPECT_EQ(wrong.load(), 0u);
+    EXPECT_TRUE(square.size() <= 64u);
+    memoize_statistics stats = square.statistics();
+    EXPECT_EQ(stats.hits + stats.misses + stats.coalesced, 80000u);
+}
+
+} // namespace TestWebKitAPI
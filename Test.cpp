@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace TestWebKitAPI {
+
+namespace {
+
+struct Test {
+    const char* suite;
+    const char* name;
+    TestFunction function;
+};
+
+std::vector<Test>& tests()
+{
+    static std::vector<Test> tests;
+    return tests;
+}
+
+std::atomic<std::size_t> allocations { 0 };
+unsigned failures = 0;
+
+} // anonymous namespace
+
+TestRegistration::TestRegistration(const char* suite, const char* name, TestFunction function)
+{
+    tests().push_back({ suite, name, function });
+}
+
+void reportFailure(const char* file, int line, const char* expression)
+{
+    ++failures;
+    std::fprintf(stderr, "%s:%d: Failure: %s\n", file, line, expression);
+}
+
+std::size_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace TestWebKitAPI
+
+void* operator new(std::size_t size)
+{
+    TestWebKitAPI::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main()
+{
+    using namespace TestWebKitAPI;
+    unsigned failedTests = 0;
+    for (const Test& test : tests()) {
+        unsigned before = failures;
+        std::printf("[ RUN      ] %s.%s\n", test.suite, test.name);
+        test.function();
+        bool passed = failures == before;
+        failedTests += !passed;
+        std::printf("[ %s ] %s.%s\n", passed ? "      OK" : " FAILED ", test.suite, test.name);
+    }
+    std::printf("%zu tests, %u failed\n", tests().size(), failedTests);
+    return failedTests ? EXIT_FAILURE : EXIT_SUCCESS;
+}
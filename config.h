@@ -0,0 +1 @@
+#include "Test.h"
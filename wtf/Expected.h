@@ -28,16 +28,65 @@
 #ifndef Expected_h
 #define Expected_h
 
+#include <atomic>
 #include <cstdlib>
+#include <exception>
 #include <functional>
 #include <initializer_list>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
 namespace WTF {
 
 // The specification expects to throw. This implementation doesn't support exceptions.
-void unexpected_fail() { abort(); }
+inline void unexpected_fail() { abort(); }
+
+// Only make_expected_from_call and value_or_throw interact with exceptions, and only when they're enabled.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define WTF_EXPECTED_EXCEPTIONS 1
+#else
+#define WTF_EXPECTED_EXCEPTIONS 0
+#endif
+
+// Debug builds can define WTF_EXPECTED_CHECKED to 1 to catch results which are used without being checked:
+// reading the value or error before asking has_value() or operator bool, and destroying an error that
+// nobody looked at. Checked expecteds can't be constexpr and aren't trivially destructible. When it's 0,
+// the tracking compiles to nothing.
+#ifndef WTF_EXPECTED_CHECKED
+#define WTF_EXPECTED_CHECKED 0
+#endif
+
+// Checked and unchecked expecteds differ in layout and destructor, so checked builds declare everything
+// below in an inline namespace, the way _GLIBCXX_DEBUG does for containers. Code built one way which
+// passes an expected, or anything holding one, to code built the other way then fails to link instead
+// of disagreeing about what it passed. The other expected headers use the same namespace.
+#if WTF_EXPECTED_CHECKED
+#define WTF_EXPECTED_NAMESPACE_BEGIN inline namespace expected_checked {
+#define WTF_EXPECTED_NAMESPACE_END }
+#else
+#define WTF_EXPECTED_NAMESPACE_BEGIN
+#define WTF_EXPECTED_NAMESPACE_END
+#endif
+
+WTF_EXPECTED_NAMESPACE_BEGIN
+
+enum class expected_violation { unchecked_access, unchecked_error_destroyed };
+typedef void (*expected_violation_handler)(expected_violation);
+
+namespace ExpectedDetail {
+
+inline void expected_default_violation_handler(expected_violation) { unexpected_fail(); }
+inline std::atomic<expected_violation_handler>& expected_current_violation_handler()
+{
+    static std::atomic<expected_violation_handler> handler { expected_default_violation_handler };
+    return handler;
+}
+
+} // namespace ExpectedDetail
+
+// Returns the previous handler. The default one aborts. Handlers are only ever called when WTF_EXPECTED_CHECKED is 1.
+inline expected_violation_handler set_expected_violation_handler(expected_violation_handler handler) { return ExpectedDetail::expected_current_violation_handler().exchange(handler ? handler : ExpectedDetail::expected_default_violation_handler); }
 
 // Part of <optional>, used in <expected>.
 struct nullopt_t {
@@ -50,10 +99,10 @@ template <class E>
 class unexpected_type {
 public:
     unexpected_type() = delete;
-    constexpr explicit unexpected_type(const E& e) : val(e) { }
-    constexpr explicit unexpected_type(E&& e) : val(std::move(e)) { }
-    constexpr const E& value() const { return val; }
-    constexpr E& value() { return val; }
+    constexpr explicit unexpected_type(const E& e) noexcept(std::is_nothrow_copy_constructible<E>::value) : val(e) { }
+    constexpr explicit unexpected_type(E&& e) noexcept(std::is_nothrow_move_constructible<E>::value) : val(std::move(e)) { }
+    constexpr const E& value() const noexcept { return val; }
+    constexpr E& value() noexcept { return val; }
 
 private:
     E val;
@@ -71,10 +120,11 @@ template <class E> constexpr unexpected_type<std::decay_t<E>> make_unexpected(E&
 struct unexpect_t { unexpect_t() = delete; };
 constexpr unexpect_t unexpect { };
 
-namespace {
+namespace ExpectedDetail {
 
 static constexpr enum class expected_value_tag_type { } expected_value_tag{ };
 static constexpr enum class expected_error_tag_type { } expected_error_tag{ };
+static constexpr enum class expected_error_in_place_tag_type { } expected_error_in_place_tag{ };
 
 template <class T, class E>
 union expected_constexpr_storage {
@@ -83,11 +133,14 @@ union expected_constexpr_storage {
     char dummy;
     value_type val;
     error_type err;
-    constexpr expected_constexpr_storage() : dummy() { }
-    constexpr expected_constexpr_storage(expected_value_tag_type) : val() { }
-    constexpr expected_constexpr_storage(expected_error_tag_type) : err() { }
-    constexpr expected_constexpr_storage(expected_value_tag_type, const value_type& v) : val(v) { }
-    constexpr expected_constexpr_storage(expected_error_tag_type, const error_type& e) : err(e) { }
+    constexpr expected_constexpr_storage() noexcept : dummy() { }
+    constexpr expected_constexpr_storage(expected_value_tag_type) noexcept(std::is_nothrow_default_constructible<value_type>::value) : val() { }
+    constexpr expected_constexpr_storage(expected_error_tag_type) noexcept(std::is_nothrow_default_constructible<error_type>::value) : err() { }
+    constexpr expected_constexpr_storage(expected_value_tag_type, const value_type& v) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : val(v) { }
+    constexpr expected_constexpr_storage(expected_value_tag_type, value_type&& v) noexcept(std::is_nothrow_move_constructible<value_type>::value) : val(std::move(v)) { }
+    constexpr expected_constexpr_storage(expected_error_tag_type, const error_type& e) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : err(e) { }
+    constexpr expected_constexpr_storage(expected_error_tag_type, error_type&& e) noexcept(std::is_nothrow_move_constructible<error_type>::value) : err(std::move(e)) { }
+    template <class... Args> constexpr expected_constexpr_storage(expected_error_in_place_tag_type, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : err(std::forward<Args>(args)...) { }
     ~expected_constexpr_storage() = default;
 };
 
@@ -98,11 +151,14 @@ union expected_storage {
     char dummy;
     value_type val;
     error_type err;
-    constexpr expected_storage() : dummy() { }
-    constexpr expected_storage(expected_value_tag_type) : val() { }
-    constexpr expected_storage(expected_error_tag_type) : err() { }
-    constexpr expected_storage(expected_value_tag_type, const value_type& val) : val(val) { }
-    constexpr expected_storage(expected_error_tag_type, const error_type& err) : err(err) { }
+    constexpr expected_storage() noexcept : dummy() { }
+    constexpr expected_storage(expected_value_tag_type) noexcept(std::is_nothrow_default_constructible<value_type>::value) : val() { }
+    constexpr expected_storage(expected_error_tag_type) noexcept(std::is_nothrow_default_constructible<error_type>::value) : err() { }
+    constexpr expected_storage(expected_value_tag_type, const value_type& val) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : val(val) { }
+    constexpr expected_storage(expected_value_tag_type, value_type&& val) noexcept(std::is_nothrow_move_constructible<value_type>::value) : val(std::move(val)) { }
+    constexpr expected_storage(expected_error_tag_type, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : err(err) { }
+    constexpr expected_storage(expected_error_tag_type, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : err(std::move(err)) { }
+    template <class... Args> constexpr expected_storage(expected_error_in_place_tag_type, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : err(std::forward<Args>(args)...) { }
     ~expected_storage() { }
 };
 
@@ -112,10 +168,12 @@ union expected_constexpr_storage<void, E> {
     typedef E error_type;
     char dummy;
     error_type err;
-    constexpr expected_constexpr_storage() : dummy() { }
-    constexpr expected_constexpr_storage(expected_value_tag_type) : dummy() { }
-    constexpr expected_constexpr_storage(expected_error_tag_type) : err() { }
-    constexpr expected_constexpr_storage(expected_error_tag_type, const error_type& e) : err(e) { }
+    constexpr expected_constexpr_storage() noexcept : dummy() { }
+    constexpr expected_constexpr_storage(expected_value_tag_type) noexcept : dummy() { }
+    constexpr expected_constexpr_storage(expected_error_tag_type) noexcept(std::is_nothrow_default_constructible<error_type>::value) : err() { }
+    constexpr expected_constexpr_storage(expected_error_tag_type, const error_type& e) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : err(e) { }
+    constexpr expected_constexpr_storage(expected_error_tag_type, error_type&& e) noexcept(std::is_nothrow_move_constructible<error_type>::value) : err(std::move(e)) { }
+    template <class... Args> constexpr expected_constexpr_storage(expected_error_in_place_tag_type, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : err(std::forward<Args>(args)...) { }
     ~expected_constexpr_storage() = default;
 };
 
@@ -125,10 +183,12 @@ union expected_storage<void, E> {
     typedef E error_type;
     char dummy;
     error_type err;
-    constexpr expected_storage() : dummy() { }
-    constexpr expected_storage(expected_value_tag_type) : dummy() { }
-    constexpr expected_storage(expected_error_tag_type) : err() { }
-    constexpr expected_storage(expected_error_tag_type, const error_type& err) : err(err) { }
+    constexpr expected_storage() noexcept : dummy() { }
+    constexpr expected_storage(expected_value_tag_type) noexcept : dummy() { }
+    constexpr expected_storage(expected_error_tag_type) noexcept(std::is_nothrow_default_constructible<error_type>::value) : err() { }
+    constexpr expected_storage(expected_error_tag_type, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : err(err) { }
+    constexpr expected_storage(expected_error_tag_type, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : err(std::move(err)) { }
+    template <class... Args> constexpr expected_storage(expected_error_in_place_tag_type, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : err(std::forward<Args>(args)...) { }
     ~expected_storage() { }
 };
 
@@ -138,11 +198,14 @@ struct expected_constexpr_base {
     typedef E error_type;
     expected_constexpr_storage<value_type, error_type> s;
     bool has;
-    constexpr expected_constexpr_base() : s(), has(true) { }
-    constexpr expected_constexpr_base(expected_value_tag_type tag) : s(tag), has(true) { }
-    constexpr expected_constexpr_base(expected_error_tag_type tag) : s(tag), has(false) { }
-    constexpr expected_constexpr_base(expected_value_tag_type tag, const value_type& val) : s(tag, val), has(true) { }
-    constexpr expected_constexpr_base(expected_error_tag_type tag, const error_type& err) : s(tag, err), has(false) { }
+    constexpr expected_constexpr_base() noexcept : s(), has(true) { }
+    constexpr expected_constexpr_base(expected_value_tag_type tag) noexcept(std::is_nothrow_default_constructible<value_type>::value) : s(tag), has(true) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag) noexcept(std::is_nothrow_default_constructible<error_type>::value) : s(tag), has(false) { }
+    constexpr expected_constexpr_base(expected_value_tag_type tag, const value_type& val) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : s(tag, val), has(true) { }
+    constexpr expected_constexpr_base(expected_value_tag_type tag, value_type&& val) noexcept(std::is_nothrow_move_constructible<value_type>::value) : s(tag, std::move(val)), has(true) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : s(tag, err), has(false) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : s(tag, std::move(err)), has(false) { }
+    template <class... Args> constexpr expected_constexpr_base(expected_error_in_place_tag_type tag, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : s(tag, std::forward<Args>(args)...), has(false) { }
     ~expected_constexpr_base() = default;
 };
 
@@ -152,12 +215,15 @@ struct expected_base {
     typedef E error_type;
     expected_storage<value_type, error_type> s;
     bool has;
-    constexpr expected_base() : s(), has(true) { }
-    constexpr expected_base(expected_value_tag_type tag) : s(tag), has(true) { }
-    constexpr expected_base(expected_error_tag_type tag) : s(tag), has(false) { }
-    constexpr expected_base(expected_value_tag_type tag, const value_type& val) : s(tag, val), has(true) { }
-    constexpr expected_base(expected_error_tag_type tag, const error_type& err) : s(tag, err), has(false) { }
-    expected_base(const expected_base& o)
+    constexpr expected_base() noexcept : s(), has(true) { }
+    constexpr expected_base(expected_value_tag_type tag) noexcept(std::is_nothrow_default_constructible<value_type>::value) : s(tag), has(true) { }
+    constexpr expected_base(expected_error_tag_type tag) noexcept(std::is_nothrow_default_constructible<error_type>::value) : s(tag), has(false) { }
+    constexpr expected_base(expected_value_tag_type tag, const value_type& val) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : s(tag, val), has(true) { }
+    constexpr expected_base(expected_value_tag_type tag, value_type&& val) noexcept(std::is_nothrow_move_constructible<value_type>::value) : s(tag, std::move(val)), has(true) { }
+    constexpr expected_base(expected_error_tag_type tag, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : s(tag, err), has(false) { }
+    constexpr expected_base(expected_error_tag_type tag, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : s(tag, std::move(err)), has(false) { }
+    template <class... Args> constexpr expected_base(expected_error_in_place_tag_type tag, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : s(tag, std::forward<Args>(args)...), has(false) { }
+    expected_base(const expected_base& o) noexcept(std::is_nothrow_copy_constructible<value_type>::value && std::is_nothrow_copy_constructible<error_type>::value)
     : has(o.has)
     {
         if (has)
@@ -165,7 +231,7 @@ struct expected_base {
         else
             ::new (&s.err) error_type(o.s.err);
     }
-    expected_base(const expected_base&& o)
+    expected_base(expected_base&& o) noexcept(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_move_constructible<error_type>::value)
     : has(o.has)
     {
         if (has)
@@ -188,10 +254,12 @@ struct expected_constexpr_base<void, E> {
     typedef E error_type;
     expected_constexpr_storage<value_type, error_type> s;
     bool has;
-    constexpr expected_constexpr_base() : s(), has(true) { }
-    constexpr expected_constexpr_base(expected_value_tag_type tag) : s(tag), has(true) { }
-    constexpr expected_constexpr_base(expected_error_tag_type tag) : s(tag), has(false) { }
-    constexpr expected_constexpr_base(expected_error_tag_type tag, const error_type& err) : s(tag, err), has(false) { }
+    constexpr expected_constexpr_base() noexcept : s(), has(true) { }
+    constexpr expected_constexpr_base(expected_value_tag_type tag) noexcept : s(tag), has(true) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag) noexcept(std::is_nothrow_default_constructible<error_type>::value) : s(tag), has(false) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : s(tag, err), has(false) { }
+    constexpr expected_constexpr_base(expected_error_tag_type tag, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : s(tag, std::move(err)), has(false) { }
+    template <class... Args> constexpr expected_constexpr_base(expected_error_in_place_tag_type tag, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : s(tag, std::forward<Args>(args)...), has(false) { }
     ~expected_constexpr_base() = default;
 };
 
@@ -201,17 +269,19 @@ struct expected_base<void, E> {
     typedef E error_type;
     expected_storage<value_type, error_type> s;
     bool has;
-    constexpr expected_base() : s(), has(true) { }
-    constexpr expected_base(expected_value_tag_type tag) : s(tag), has(true) { }
-    constexpr expected_base(expected_error_tag_type tag) : s(tag), has(false) { }
-    constexpr expected_base(expected_error_tag_type tag, const error_type& err) : s(tag, err), has(false) { }
-    expected_base(const expected_base& o)
+    constexpr expected_base() noexcept : s(), has(true) { }
+    constexpr expected_base(expected_value_tag_type tag) noexcept : s(tag), has(true) { }
+    constexpr expected_base(expected_error_tag_type tag) noexcept(std::is_nothrow_default_constructible<error_type>::value) : s(tag), has(false) { }
+    constexpr expected_base(expected_error_tag_type tag, const error_type& err) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : s(tag, err), has(false) { }
+    constexpr expected_base(expected_error_tag_type tag, error_type&& err) noexcept(std::is_nothrow_move_constructible<error_type>::value) : s(tag, std::move(err)), has(false) { }
+    template <class... Args> constexpr expected_base(expected_error_in_place_tag_type tag, Args&&... args) noexcept(std::is_nothrow_constructible<error_type, Args&&...>::value) : s(tag, std::forward<Args>(args)...), has(false) { }
+    expected_base(const expected_base& o) noexcept(std::is_nothrow_copy_constructible<error_type>::value)
     : has(o.has)
     {
         if (!has)
             ::new (&s.err) error_type(o.s.err);
     }
-    expected_base(const expected_base&& o)
+    expected_base(expected_base&& o) noexcept(std::is_nothrow_move_constructible<error_type>::value)
     : has(o.has)
     {
         if (!has)
@@ -224,19 +294,126 @@ struct expected_base<void, E> {
     }
 };
 
+// Deletes expected's copy constructor when T or E can't be copied. The bases' copy constructors are
+// user-provided, so without this std::is_copy_constructible would be true for move-only payloads.
+template <bool copyable>
+struct expected_copy_control { };
+
+template <>
+struct expected_copy_control<false> {
+    expected_copy_control() = default;
+    expected_copy_control(const expected_copy_control&) = delete;
+    expected_copy_control(expected_copy_control&&) = default;
+    expected_copy_control& operator=(const expected_copy_control&) = default;
+    expected_copy_control& operator=(expected_copy_control&&) = default;
+};
+
+// Whether a result was checked before use. A move hands the obligation to check over to the new object, and
+// a copy is a new result which needs checking on its own. Unless WTF_EXPECTED_CHECKED is 1, this is an empty
+// base whose members do nothing.
+#if WTF_EXPECTED_CHECKED
+struct expected_check_state {
+    // Checking goes through const& and may happen on several threads at once, so the flag is a relaxed atomic
+    // which is only written while it is still clear.
+    mutable std::atomic<bool> checked { false };
+    expected_check_state() = default;
+    expected_check_state(const expected_check_state&) noexcept { }
+    expected_check_state(expected_check_state&& o) noexcept : checked(o.is_checked()) { o.mark_checked(); }
+    expected_check_state& operator=(const expected_check_state&) noexcept
+    {
+        checked.store(false, std::memory_order_relaxed);
+        return *this;
+    }
+    expected_check_state& operator=(expected_check_state&& o) noexcept
+    {
+        checked.store(o.is_checked(), std::memory_order_relaxed);
+        o.mark_checked();
+        return *this;
+    }
+    bool is_checked() const noexcept { return checked.load(std::memory_order_relaxed); }
+    void mark_checked() const noexcept
+    {
+        if (!is_checked())
+            checked.store(true, std::memory_order_relaxed);
+    }
+    void require_checked() const noexcept
+    {
+        if (!is_checked() && !checked.exchange(true, std::memory_order_relaxed))
+            report(expected_violation::unchecked_access);
+    }
+    void check_destruction(bool hasValue) const noexcept
+    {
+        if (!hasValue && !is_checked())
+            report(expected_violation::unchecked_error_destroyed);
+    }
+    void swap_check_state(expected_check_state& o) noexcept
+    {
+        bool mine = is_checked();
+        checked.store(o.is_checked(), std::memory_order_relaxed);
+        o.checked.store(mine, std::memory_order_relaxed);
+    }
+    static void report(expected_violation violation) noexcept { expected_current_violation_handler().load()(violation); }
+};
+#else
+struct expected_check_state {
+    constexpr void mark_checked() const noexcept { }
+    constexpr void require_checked() const noexcept { }
+    constexpr void check_destruction(bool) const noexcept { }
+    constexpr void swap_check_state(expected_check_state&) noexcept { }
+};
+#endif
+
+template <class T, class E>
+constexpr bool expected_copyable() { return (std::is_void<T>::value || std::is_copy_constructible<T>::value) && std::is_copy_constructible<E>::value; }
+
+template <class T, class E>
+using expected_copy_control_select = expected_copy_control<expected_copyable<T, E>()>;
+
+// Stands in for the parameter of expected's copy assignment when T or E can't be copied, so that the
+// operator isn't declared and the implicit one is deleted.
+struct expected_not_copy_assignable { };
+
+template <class Expected, bool copyable>
+using expected_copy_assignment_source = typename std::conditional<copyable, const Expected&, const expected_not_copy_assignable&>::type;
+
+// expected_constexpr_base relies on its union's implicit copy and move, which only work for trivial payloads.
+template <class T>
+constexpr bool expected_trivial() { return std::is_void<T>::value || (std::is_trivially_copy_constructible<T>::value && std::is_trivially_move_constructible<T>::value && std::is_trivially_destructible<T>::value); }
+
 template <class T, class E>
 using expected_base_select = typename std::conditional<
-    ((std::is_void<T>::value || std::is_trivially_destructible<T>::value)
-     && std::is_trivially_destructible<E>::value),
+    expected_trivial<T>() && expected_trivial<E>(),
     expected_constexpr_base<typename std::remove_const<T>::type, typename std::remove_const<E>::type>,
     expected_base<typename std::remove_const<T>::type, typename std::remove_const<E>::type>
 >::type;
 
- } // anonymous namespace
+// Swapping a value with an error moves one of them to a temporary and destroys it before the other is moved
+// over. If that move throws, restore puts the temporary back. Rebuilding from the temporary can't leave a
+// destroyed object behind, so if it throws too, it terminates instead.
+template <class Rebuild>
+void expected_rebuild(Rebuild&& rebuild) noexcept { rebuild(); }
+
+template <class Construct, class Restore>
+void expected_construct_or_restore(Construct&& construct, Restore&& restore)
+{
+#if WTF_EXPECTED_EXCEPTIONS
+    try {
+        construct();
+    } catch (...) {
+        expected_rebuild(restore);
+        throw;
+    }
+#else
+    (void)restore;
+    construct();
+#endif
+}
+
+} // namespace ExpectedDetail
 
 template <class T, class E>
-class expected : private expected_base_select<T, E> {
-    typedef expected_base_select<T, E> base;
+class expected : private ExpectedDetail::expected_base_select<T, E>, private ExpectedDetail::expected_copy_control_select<T, E>, private ExpectedDetail::expected_check_state {
+    typedef ExpectedDetail::expected_base_select<T, E> base;
 
 public:
     typedef typename base::value_type value_type;
@@ -244,75 +421,102 @@ public:
 
 private:
     typedef expected<value_type, error_type> type;
+    static constexpr bool nothrow_copy = std::is_nothrow_copy_constructible<value_type>::value && std::is_nothrow_copy_constructible<error_type>::value;
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_move_constructible<error_type>::value;
+    static constexpr bool nothrow_swap = nothrow_move && std::is_nothrow_swappable<value_type>::value && std::is_nothrow_swappable<error_type>::value;
 
 public:
     template <class U> struct rebind { using type = expected<U, error_type>; };
 
-    constexpr expected() : base(expected_value_tag) { }
+    constexpr expected() noexcept(std::is_nothrow_default_constructible<value_type>::value) : base(ExpectedDetail::expected_value_tag) { }
     expected(const expected&) = default;
     expected(expected&&) = default;
-    constexpr expected(const value_type& e) : base(expected_value_tag, e) { }
-    constexpr expected(value_type&& e) : base(expected_value_tag, std::move(e)) { }
+    constexpr expected(const value_type& e) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : base(ExpectedDetail::expected_value_tag, e) { }
+    constexpr expected(value_type&& e) noexcept(std::is_nothrow_move_constructible<value_type>::value) : base(ExpectedDetail::expected_value_tag, std::move(e)) { }
     //template <class... Args> constexpr explicit expected(in_place_t, Args&&...);
     //template <class U, class... Args> constexpr explicit expected(in_place_t, std::initializer_list<U>, Args&&...);
-    constexpr expected(unexpected_type<error_type> const& u) : base(expected_error_tag, u.value()) { }
-    template <class Err> constexpr expected(unexpected_type<Err> const& u) : base(expected_error_tag, u.value()) { }
+    constexpr expected(unexpected_type<error_type> const& u) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : base(ExpectedDetail::expected_error_tag, u.value()) { }
+    constexpr expected(unexpected_type<error_type>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value) : base(ExpectedDetail::expected_error_tag, std::move(u.value())) { }
+    // Converting from another error type is explicit when converting the error is, as for std::expected.
+    template <class Err, std::enable_if_t<std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, const Err&>::value && !std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, Err&&>::value && !std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
     //template <class... Args> constexpr explicit expected(unexpect_t, Args&&...);
     //template <class U, class... Args> constexpr explicit expected(unexpect_t, std::initializer_list<U>, Args&&...);
 
+#if WTF_EXPECTED_CHECKED
+    ~expected() { this->check_destruction(base::has); }
+#else
     ~expected() = default;
+#endif
 
-    expected& operator=(const expected& e) { type(e).swap(*this); return *this; }
-    expected& operator=(expected&& e) { type(std::move(e)).swap(*this); return *this; }
-    template <class U> expected& operator=(U&& u) { type(std::move(u)).swap(*this); return *this; }
-    expected& operator=(const unexpected_type<error_type>& u) { type(u).swap(*this); return *this; }
-    expected& operator=(unexpected_type<error_type>&& u) { type(std::move(u)).swap(*this); return *this; }
+    expected& operator=(ExpectedDetail::expected_copy_assignment_source<expected, ExpectedDetail::expected_copyable<T, E>()> e) noexcept(nothrow_copy && nothrow_swap) { type(e).swap(*this); return *this; }
+    expected& operator=(expected&& e) noexcept(nothrow_move && nothrow_swap) { type(std::move(e)).swap(*this); return *this; }
+    template <class U, class = std::enable_if_t<std::is_constructible<type, U&&>::value>> expected& operator=(U&& u) noexcept(std::is_nothrow_constructible<type, U&&>::value && nothrow_swap) { type(std::forward<U>(u)).swap(*this); return *this; }
+    expected& operator=(const unexpected_type<error_type>& u) noexcept(std::is_nothrow_copy_constructible<error_type>::value && nothrow_swap) { type(u).swap(*this); return *this; }
+    expected& operator=(unexpected_type<error_type>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value && nothrow_swap) { type(std::move(u)).swap(*this); return *this; }
     //template <class... Args> void emplace(Args&&...);
     //template <class U, class... Args> void emplace(std::initializer_list<U>, Args&&...);
 
-    void swap(expected& o) {
+    void swap(expected& o) noexcept(nothrow_swap)
+    {
+        swap_storage(o);
+        this->swap_check_state(o);
+    }
+
+    constexpr const value_type* operator->() const noexcept { this->require_checked(); return &base::s.val; }
+    value_type* operator->() noexcept { this->require_checked(); return &base::s.val; }
+    constexpr const value_type& operator*() const & noexcept { this->require_checked(); return base::s.val; }
+    value_type& operator*() & noexcept { this->require_checked(); return base::s.val; }
+    constexpr const value_type&& operator*() const && noexcept { this->require_checked(); return std::move(base::s.val); }
+    constexpr value_type&& operator*() && noexcept { this->require_checked(); return std::move(base::s.val); }
+    constexpr explicit operator bool() const noexcept { this->mark_checked(); return base::has; }
+    constexpr bool has_value() const noexcept { this->mark_checked(); return base::has; }
+    constexpr const value_type& value() const & noexcept { this->require_checked(); return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
+    constexpr value_type& value() & noexcept { this->require_checked(); return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
+    constexpr const value_type&& value() const && noexcept { this->require_checked(); return base::has ? std::move(base::s.val) : (unexpected_fail(), std::move(base::s.val)); }
+    constexpr value_type&& value() && noexcept { this->require_checked(); return base::has ? std::move(base::s.val) : (unexpected_fail(), std::move(base::s.val)); }
+    constexpr const error_type& error() const & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
+    error_type& error() & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
+    constexpr error_type&& error() && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }
+    constexpr const error_type&& error() const && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }
+    constexpr unexpected_type<error_type> get_unexpected() const noexcept(std::is_nothrow_copy_constructible<error_type>::value) { this->require_checked(); return unexpected_type<error_type>(base::s.err); }
+    template <class U> constexpr value_type value_or(U&& u) const & noexcept(std::is_nothrow_copy_constructible<value_type>::value && std::is_nothrow_constructible<value_type, U&&>::value) { this->mark_checked(); return base::has ? **this : static_cast<value_type>(std::forward<U>(u)); }
+    template <class U> value_type value_or(U&& u) && noexcept(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_constructible<value_type, U&&>::value) { this->mark_checked(); return base::has ? std::move(**this) : static_cast<value_type>(std::forward<U>(u)); }
+
+private:
+    void swap_storage(expected& o) noexcept(nothrow_swap) {
       using std::swap;
       if (base::has && o.has) {
         swap(base::s.val, o.s.val);
       } else if (base::has && !o.has) {
-        error_type e(std::move(o.s.err));
-        ::new (&o.s.val) value_type(std::move(base::s.val));
-        ::new (&base::s.err) error_type(e);
+        // The temporary holds whichever side can be moved back without throwing.
+        if (!std::is_nothrow_move_constructible<error_type>::value && std::is_nothrow_move_constructible<value_type>::value) {
+          value_type v(std::move(base::s.val));
+          base::s.val.value_type::~value_type();
+          ExpectedDetail::expected_construct_or_restore([&] { ::new (&base::s.err) error_type(std::move(o.s.err)); }, [&] { ::new (&base::s.val) value_type(std::move(v)); });
+          o.s.err.error_type::~error_type();
+          ExpectedDetail::expected_rebuild([&] { ::new (&o.s.val) value_type(std::move(v)); });
+        } else {
+          error_type e(std::move(o.s.err));
+          o.s.err.error_type::~error_type();
+          ExpectedDetail::expected_construct_or_restore([&] { ::new (&o.s.val) value_type(std::move(base::s.val)); }, [&] { ::new (&o.s.err) error_type(std::move(e)); });
+          base::s.val.value_type::~value_type();
+          ExpectedDetail::expected_rebuild([&] { ::new (&base::s.err) error_type(std::move(e)); });
+        }
         swap(base::has, o.has);
       } else if (!base::has && o.has) {
-        value_type v(std::move(o.s.val));
-        ::new (&o.s.err) error_type(std::move(base::s.err));
-        ::new (&base::s.val) value_type(v);
-        swap(base::has, o.has);
+        o.swap_storage(*this);
       } else {
         swap(base::s.err, o.s.err);
       }
     }
-
-    constexpr const value_type* operator->() const { return &base::s.val; }
-    value_type* operator->() { return &base::s.val; }
-    constexpr const value_type& operator*() const & { return base::s.val; }
-    value_type& operator*() & { return base::s.val; }
-    constexpr const value_type&& operator*() const && { return std::move(base::s.val); }
-    constexpr value_type&& operator*() && { return std::move(base::s.val); }
-    constexpr explicit operator bool() const { return base::has; }
-    constexpr bool has_value() const { return base::has; }
-    constexpr const value_type& value() const & { return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
-    constexpr value_type& value() & { return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
-    constexpr const value_type&& value() const && { return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
-    constexpr value_type&& value() && { return base::has ? base::s.val : (unexpected_fail(), base::s.val); }
-    constexpr const error_type& error() const & { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    error_type& error() & { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    constexpr error_type&& error() && { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    constexpr const error_type&& error() const && { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    constexpr unexpected_type<error_type> get_unexpected() const { return unexpected_type<error_type>(base::s.err); }
-    template <class U> constexpr value_type value_or(U&& u) const & { return base::has ? **this : static_cast<value_type>(std::forward<U>(u)); }
-    template <class U> value_type value_or(U&& u) && { return base::has ? std::move(**this) : static_cast<value_type>(std::forward<U>(u)); }
 };
 
 template <class E>
-class expected<void, E> : private expected_base_select<void, E> {
-    typedef expected_base_select<void, E> base;
+class expected<void, E> : private ExpectedDetail::expected_base_select<void, E>, private ExpectedDetail::expected_copy_control_select<void, E>, private ExpectedDetail::expected_check_state {
+    typedef ExpectedDetail::expected_base_select<void, E> base;
 
 public:
     typedef typename base::value_type value_type;
@@ -320,49 +524,151 @@ public:
 
 private:
     typedef expected<value_type, error_type> type;
+    static constexpr bool nothrow_copy = std::is_nothrow_copy_constructible<error_type>::value;
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible<error_type>::value;
+    static constexpr bool nothrow_swap = nothrow_move && std::is_nothrow_swappable<error_type>::value;
 
 public:
     template <class U> struct rebind { typedef expected<U, error_type> type; };
 
-    constexpr expected() : base(expected_value_tag) { }
+    constexpr expected() noexcept : base(ExpectedDetail::expected_value_tag) { }
     expected(const expected&) = default;
     expected(expected&&) = default;
     //constexpr explicit expected(in_place_t);
-    constexpr expected(unexpected_type<E> const& u) : base(expected_error_tag, u.value()) { }
-    template <class Err> constexpr expected(unexpected_type<Err> const& u) : base(expected_error_tag, u.value()) { }
-
+    constexpr expected(unexpected_type<E> const& u) noexcept(std::is_nothrow_copy_constructible<error_type>::value) : base(ExpectedDetail::expected_error_tag, u.value()) { }
+    constexpr expected(unexpected_type<E>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value) : base(ExpectedDetail::expected_error_tag, std::move(u.value())) { }
+    template <class Err, std::enable_if_t<std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, const Err&>::value && !std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, Err&&>::value && !std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
+
+#if WTF_EXPECTED_CHECKED
+    ~expected() { this->check_destruction(base::has); }
+#else
     ~expected() = default;
+#endif
 
-    expected& operator=(const expected& e) { type(e).swap(*this); return *this; }
-    expected& operator=(expected&& e) { type(std::move(e)).swap(*this); return *this; }
-    expected& operator=(const unexpected_type<E>& u) { type(u).swap(*this); return *this; } // Not in the current paper.
-    expected& operator=(unexpected_type<E>&& u) { type(std::move(u)).swap(*this); return *this; } // Not in the current paper.
+    expected& operator=(ExpectedDetail::expected_copy_assignment_source<expected, ExpectedDetail::expected_copyable<void, E>()> e) noexcept(nothrow_copy && nothrow_swap) { type(e).swap(*this); return *this; }
+    expected& operator=(expected&& e) noexcept(nothrow_move && nothrow_swap) { type(std::move(e)).swap(*this); return *this; }
+    expected& operator=(const unexpected_type<E>& u) noexcept(std::is_nothrow_copy_constructible<error_type>::value && nothrow_swap) { type(u).swap(*this); return *this; } // Not in the current paper.
+    expected& operator=(unexpected_type<E>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value && nothrow_swap) { type(std::move(u)).swap(*this); return *this; } // Not in the current paper.
     //void emplace();
 
-    void swap(expected& o) {
+    void swap(expected& o) noexcept(nothrow_swap)
+    {
+        swap_storage(o);
+        this->swap_check_state(o);
+    }
+
+    constexpr explicit operator bool() const noexcept { this->mark_checked(); return base::has; }
+    constexpr bool has_value() const noexcept { this->mark_checked(); return base::has; }
+    void value() const noexcept { this->require_checked(); if (!base::has) unexpected_fail(); }
+    constexpr const E& error() const & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
+    E& error() & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); } // Not in the current paper.
+    constexpr E&& error() && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }
+    constexpr const E&& error() const && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }  // Not in the current paper.
+    //constexpr E& error() &;
+    constexpr unexpected_type<E> get_unexpected() const noexcept(std::is_nothrow_copy_constructible<error_type>::value) { this->require_checked(); return unexpected_type<E>(base::s.err); }
+
+private:
+    void swap_storage(expected& o) noexcept(nothrow_swap) {
       using std::swap;
       if (base::has && o.has) {
       } else if (base::has && !o.has) {
-        error_type e(std::move(o.s.err));
-        ::new (&base::s.err) error_type(e);
+        ::new (&base::s.err) error_type(std::move(o.s.err));
+        o.s.err.error_type::~error_type();
         swap(base::has, o.has);
       } else if (!base::has && o.has) {
         ::new (&o.s.err) error_type(std::move(base::s.err));
+        base::s.err.error_type::~error_type();
         swap(base::has, o.has);
       } else {
         swap(base::s.err, o.s.err);
       }
     }
+};
 
-    constexpr explicit operator bool() const { return base::has; }
-    constexpr bool has_value() const { return base::has; }
-    void value() const { if (!base::has) unexpected_fail(); }
-    constexpr const E& error() const & { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    E& error() & { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); } // Not in the current paper.
-    constexpr E&& error() && { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
-    constexpr const E&& error() const && { return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }  // Not in the current paper.
-    //constexpr E& error() &;
-    constexpr unexpected_type<E> get_unexpected() const { return unexpected_type<E>(base::s.err); }
+// expected<T&, E> refers to a T which lives elsewhere, e.g. in a container, instead of holding a copy of it.
+// It stores a pointer but has reference semantics: it can't be null, it can't bind to a temporary, and
+// assignment rebinds it instead of assigning through it. Constness is shallow, as it is for references.
+template <class T, class E>
+class expected<T&, E> : private ExpectedDetail::expected_base_select<T*, E>, private ExpectedDetail::expected_copy_control_select<T*, E>, private ExpectedDetail::expected_check_state {
+    typedef ExpectedDetail::expected_base_select<T*, E> base;
+
+public:
+    typedef T& value_type;
+    typedef typename base::error_type error_type;
+
+private:
+    typedef expected<value_type, error_type> type;
+    static constexpr bool nothrow_copy = std::is_nothrow_copy_constructible<error_type>::value;
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible<error_type>::value;
+    static constexpr bool nothrow_swap = nothrow_move && std::is_nothrow_swappable<error_type>::value;
+
+public:
+    template <class U> struct rebind { typedef expected<U, error_type> type; };
+
+    expected() = delete;
+    expected(const expected&) = default;
+    expected(expected&&) = default;
+    constexpr expected(value_type v) noexcept : base(ExpectedDetail::expected_value_tag, std::addressof(v)) { }
+    expected(T&&) = delete;
+    template <class U, class = std::enable_if_t<!std::is_same<U, T>::value && std::is_convertible<U*, T*>::value>>
+    constexpr expected(const expected<U&, error_type>& o) noexcept(nothrow_copy) : base(o ? base(ExpectedDetail::expected_value_tag, std::addressof(*o)) : base(ExpectedDetail::expected_error_tag, o.error())) { }
+    constexpr expected(unexpected_type<error_type> const& u) noexcept(nothrow_copy) : base(ExpectedDetail::expected_error_tag, u.value()) { }
+    constexpr expected(unexpected_type<error_type>&& u) noexcept(nothrow_move) : base(ExpectedDetail::expected_error_tag, std::move(u.value())) { }
+    template <class Err, std::enable_if_t<std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, const Err&>::value && !std::is_convertible<const Err&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err> const& u) noexcept(std::is_nothrow_constructible<error_type, const Err&>::value) : base(ExpectedDetail::expected_error_in_place_tag, u.value()) { }
+    template <class Err, std::enable_if_t<std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
+    template <class Err, std::enable_if_t<std::is_constructible<error_type, Err&&>::value && !std::is_convertible<Err&&, error_type>::value, int> = 0> constexpr explicit expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_constructible<error_type, Err&&>::value) : base(ExpectedDetail::expected_error_in_place_tag, std::move(u.value())) { }
+
+#if WTF_EXPECTED_CHECKED
+    ~expected() { this->check_destruction(base::has); }
+#else
+    ~expected() = default;
+#endif
+
+    expected& operator=(ExpectedDetail::expected_copy_assignment_source<expected, ExpectedDetail::expected_copyable<T*, E>()> e) noexcept(nothrow_copy && nothrow_swap) { type(e).swap(*this); return *this; }
+    expected& operator=(expected&& e) noexcept(nothrow_move && nothrow_swap) { type(std::move(e)).swap(*this); return *this; }
+    expected& operator=(const unexpected_type<error_type>& u) noexcept(nothrow_copy && nothrow_swap) { type(u).swap(*this); return *this; }
+    expected& operator=(unexpected_type<error_type>&& u) noexcept(nothrow_move && nothrow_swap) { type(std::move(u)).swap(*this); return *this; }
+
+    void swap(expected& o) noexcept(nothrow_swap)
+    {
+        swap_storage(o);
+        this->swap_check_state(o);
+    }
+
+    constexpr T* operator->() const noexcept { this->require_checked(); return base::s.val; }
+    constexpr T& operator*() const noexcept { this->require_checked(); return *base::s.val; }
+    constexpr explicit operator bool() const noexcept { this->mark_checked(); return base::has; }
+    constexpr bool has_value() const noexcept { this->mark_checked(); return base::has; }
+    constexpr T& value() const noexcept { this->require_checked(); return base::has ? *base::s.val : (unexpected_fail(), *base::s.val); }
+    constexpr const error_type& error() const & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
+    error_type& error() & noexcept { this->require_checked(); return !base::has ? base::s.err : (unexpected_fail(), base::s.err); }
+    constexpr error_type&& error() && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }
+    constexpr const error_type&& error() const && noexcept { this->require_checked(); return !base::has ? std::move(base::s.err) : (unexpected_fail(), std::move(base::s.err)); }
+    constexpr unexpected_type<error_type> get_unexpected() const noexcept(nothrow_copy) { this->require_checked(); return unexpected_type<error_type>(base::s.err); }
+    // There's nothing for a fallback reference to refer to once the call returns, so this copies out.
+    template <class U> constexpr std::remove_cv_t<T> value_or(U&& u) const noexcept(std::is_nothrow_copy_constructible<std::remove_cv_t<T>>::value && std::is_nothrow_constructible<std::remove_cv_t<T>, U&&>::value) { this->mark_checked(); return base::has ? *base::s.val : static_cast<std::remove_cv_t<T>>(std::forward<U>(u)); }
+
+private:
+    void swap_storage(expected& o) noexcept(nothrow_swap) {
+      using std::swap;
+      if (base::has && o.has) {
+        swap(base::s.val, o.s.val);
+      } else if (base::has && !o.has) {
+        T* v = base::s.val;
+        ::new (&base::s.err) error_type(std::move(o.s.err));
+        o.s.err.error_type::~error_type();
+        o.s.val = v;
+        swap(base::has, o.has);
+      } else if (!base::has && o.has) {
+        o.swap_storage(*this);
+      } else {
+        swap(base::s.err, o.s.err);
+      }
+    }
 };
 
 template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const expected<T, E>& y) { return bool(x) == bool(y) && (x ? x.value() == y.value() : x.error() == y.error()); }
@@ -375,43 +681,154 @@ template <class T, class E> constexpr bool operator>=(const expected<T, E>& x, c
 template <class E> constexpr bool operator==(const expected<void, E>& x, const expected<void, E>& y) { return bool(x) == bool(y) && (x ? true : x.error() == y.error()); } // Not in the current paper.
 template <class E> constexpr bool operator<(const expected<void, E>& x, const expected<void, E>& y) { return (!bool(x) && bool(y)) ? false : ((bool(x) && !bool(y)) ? true : ((bool(x) && bool(y)) ? false : x.error() < y.error())); } // Not in the current paper.
 
-template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const T& y) { return x == expected<T, E>(y); }
-template <class T, class E> constexpr bool operator==(const T& x, const expected<T, E>& y) { return expected<T, E>(x) == y; }
-template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const T& y) { return x != expected<T, E>(y); }
-template <class T, class E> constexpr bool operator!=(const T& x, const expected<T, E>& y) { return expected<T, E>(x) != y; }
-template <class T, class E> constexpr bool operator<(const expected<T, E>& x, const T& y) { return x < expected<T, E>(y); }
-template <class T, class E> constexpr bool operator<(const T& x, const expected<T, E>& y) { return expected<T, E>(x) < y; }
-template <class T, class E> constexpr bool operator<=(const expected<T, E>& x, const T& y) { return x <= expected<T, E>(y); }
-template <class T, class E> constexpr bool operator<=(const T& x, const expected<T, E>& y) { return expected<T, E>(x) <= y; }
-template <class T, class E> constexpr bool operator>(const expected<T, E>& x, const T& y) { return x > expected<T, E>(y); }
-template <class T, class E> constexpr bool operator>(const T& x, const expected<T, E>& y) { return expected<T, E>(x) > y; }
-template <class T, class E> constexpr bool operator>=(const expected<T, E>& x, const T& y) { return x >= expected<T, E>(y); }
-template <class T, class E> constexpr bool operator>=(const T& x, const expected<T, E>& y) { return expected<T, E>(x) >= y; }
-
-template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const unexpected_type<E>& y) { return x == expected<T, E>(y); }
-template <class T, class E> constexpr bool operator==(const unexpected_type<E>& x, const expected<T, E>& y) { return expected<T, E>(x) == y; }
-template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const unexpected_type<E>& y) { return x != expected<T, E>(y); }
-template <class T, class E> constexpr bool operator!=(const unexpected_type<E>& x, const expected<T, E>& y) { return expected<T, E>(x) != y; }
-template <class T, class E> constexpr bool operator<(const expected<T, E>& x, const unexpected_type<E>& y) { return x < expected<T, E>(y); }  
-template <class T, class E> constexpr bool operator<(const unexpected_type<E>& x, const expected<T, E>& y) {  return expected<T, E>(x) < y; }  
-template <class T, class E> constexpr bool operator<=(const expected<T, E>& x, const unexpected_type<E>& y) { return x <= expected<T, E>(y); }
-template <class T, class E> constexpr bool operator<=(const unexpected_type<E>& x, const expected<T, E>& y) { return expected<T, E>(x) <= y; }
-template <class T, class E> constexpr bool operator>(const expected<T, E>& x, const unexpected_type<E>& y) { return x > expected<T, E>(y); }  
-template <class T, class E> constexpr bool operator>(const unexpected_type<E>& x, const expected<T, E>& y) { return expected<T, E>(x) > y; }  
-template <class T, class E> constexpr bool operator>=(const expected<T, E>& x, const unexpected_type<E>& y) { return x >= expected<T, E>(y); }
-template <class T, class E> constexpr bool operator>=(const unexpected_type<E>& x, const expected<T, E>& y) { return expected<T, E>(x) >= y; }
-
-template <typename T, typename E> void swap(expected<T, E>& x, expected<T, E>& y) { x.swap(y); }
+template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const T& y) { return bool(x) && *x == y; }
+template <class T, class E> constexpr bool operator==(const T& x, const expected<T, E>& y) { return y == x; }
+template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const T& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator!=(const T& x, const expected<T, E>& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator<(const expected<T, E>& x, const T& y) { return bool(x) && *x < y; }
+template <class T, class E> constexpr bool operator<(const T& x, const expected<T, E>& y) { return !bool(y) || x < *y; }
+template <class T, class E> constexpr bool operator<=(const expected<T, E>& x, const T& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator<=(const T& x, const expected<T, E>& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator>(const expected<T, E>& x, const T& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>(const T& x, const expected<T, E>& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>=(const expected<T, E>& x, const T& y) { return (x == y) || (x > y); }
+template <class T, class E> constexpr bool operator>=(const T& x, const expected<T, E>& y) { return (x == y) || (x > y); }
+
+// The overloads above deduce T from both sides, which can't match expected<T&, E> against a plain T.
+template <class T, class E> constexpr bool operator==(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return bool(x) && *x == y; }
+template <class T, class E> constexpr bool operator==(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return y == x; }
+template <class T, class E> constexpr bool operator!=(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator!=(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator<(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return bool(x) && *x < y; }
+template <class T, class E> constexpr bool operator<(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return !bool(y) || x < *y; }
+template <class T, class E> constexpr bool operator<=(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator<=(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator>(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>=(const expected<T&, E>& x, const std::remove_cv_t<T>& y) { return (x == y) || (x > y); }
+template <class T, class E> constexpr bool operator>=(const std::remove_cv_t<T>& x, const expected<T&, E>& y) { return (x == y) || (x > y); }
+
+template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const unexpected_type<E>& y) { return !bool(x) && x.error() == y.value(); }
+template <class T, class E> constexpr bool operator==(const unexpected_type<E>& x, const expected<T, E>& y) { return y == x; }
+template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const unexpected_type<E>& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator!=(const unexpected_type<E>& x, const expected<T, E>& y) { return !(x == y); }
+template <class T, class E> constexpr bool operator<(const expected<T, E>& x, const unexpected_type<E>& y) { return bool(x) || x.error() < y.value(); }
+template <class T, class E> constexpr bool operator<(const unexpected_type<E>& x, const expected<T, E>& y) { return !bool(y) && x.value() < y.error(); }
+template <class T, class E> constexpr bool operator<=(const expected<T, E>& x, const unexpected_type<E>& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator<=(const unexpected_type<E>& x, const expected<T, E>& y) { return (x == y) || (x < y); }
+template <class T, class E> constexpr bool operator>(const expected<T, E>& x, const unexpected_type<E>& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>(const unexpected_type<E>& x, const expected<T, E>& y) { return !(x == y) && !(x < y); }
+template <class T, class E> constexpr bool operator>=(const expected<T, E>& x, const unexpected_type<E>& y) { return (x == y) || (x > y); }
+template <class T, class E> constexpr bool operator>=(const unexpected_type<E>& x, const expected<T, E>& y) { return (x == y) || (x > y); }
+
+template <typename T, typename E> void swap(expected<T, E>& x, expected<T, E>& y) noexcept(noexcept(x.swap(y))) { x.swap(y); }
 
 template <class T, class E = WTF::nullopt_t> constexpr expected<std::decay_t<T>, E> make_expected(T&& v)
 {
     return expected<typename std::decay<T>::type, E>(std::forward<T>(v));
 }
-template <class T, class E> constexpr expected<T, std::decay_t<E>> make_expected_from_error(E&& e) { return expected<T, std::decay_t<E>>(make_unexpected(e)); }
+template <class T, class E> constexpr expected<T, std::decay_t<E>> make_expected_from_error(E&& e) { return expected<T, std::decay_t<E>>(make_unexpected(std::forward<E>(e))); }
 template <class T, class E, class U> constexpr expected<T, E> make_expected_from_error(U&& u) { return expected<T, E>(make_unexpected(E{std::forward<U>(u)})); }
-//template <class F, class E = WTF::nullopt_t> constexpr expected<typename std::result_of<F>::type, E> make_expected_from_call(F f);
 
-expected<void, WTF::nullopt_t> make_expected() { return expected<void, WTF::nullopt_t>(); }
+// Maps the exception currently being handled to an E. make_expected_from_call only instantiates this when
+// the callee can throw, so E needs no translator when all of its callees are noexcept. Specialize it for
+// your own error types; the call operator is invoked from within a catch (...) handler, so it can rethrow
+// to dispatch on the exception's type.
+template <class E> struct expected_exception_translator;
+template <> struct expected_exception_translator<nullopt_t> { nullopt_t operator()() const { return nullopt; } };
+template <> struct expected_exception_translator<std::exception_ptr> { std::exception_ptr operator()() const { return std::current_exception(); } };
+
+namespace ExpectedDetail {
+
+template <class F, class... Args>
+using expected_call_result = decltype(std::declval<F>()(std::declval<Args>()...));
+
+// Lvalue references are returned as expected<T&, E>, everything else by value.
+template <class R, class E>
+struct expected_call {
+    typedef expected<typename std::conditional<std::is_lvalue_reference<R>::value, R, std::remove_cv_t<std::remove_reference_t<R>>>::type, E> result_type;
+    template <class F, class... Args> static result_type call(F&& f, Args&&... args) { return result_type(std::forward<F>(f)(std::forward<Args>(args)...)); }
+};
+
+template <class E>
+struct expected_call<void, E> {
+    typedef expected<void, E> result_type;
+    template <class F, class... Args> static result_type call(F&& f, Args&&... args) { std::forward<F>(f)(std::forward<Args>(args)...); return result_type(); }
+};
+
+template <class Call, class E, class F, class... Args>
+typename Call::result_type expected_invoke(std::true_type /* noexcept */, F&& f, Args&&... args)
+{
+    return Call::call(std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <class Call, class E, class F, class... Args>
+typename Call::result_type expected_invoke(std::false_type /* noexcept */, F&& f, Args&&... args)
+{
+#if WTF_EXPECTED_EXCEPTIONS
+    try {
+        return Call::call(std::forward<F>(f), std::forward<Args>(args)...);
+    } catch (...) {
+        return make_unexpected(expected_exception_translator<E>()());
+    }
+#else
+    return Call::call(std::forward<F>(f), std::forward<Args>(args)...);
+#endif
+}
+
+} // namespace ExpectedDetail
+
+// Calls f(args...), turning anything it throws into an error through expected_exception_translator<E>.
+// When the call is noexcept there's nothing to catch, and this compiles down to a plain call.
+template <class E = WTF::nullopt_t, class F, class... Args>
+typename ExpectedDetail::expected_call<ExpectedDetail::expected_call_result<F&&, Args&&...>, E>::result_type make_expected_from_call(F&& f, Args&&... args)
+{
+    typedef ExpectedDetail::expected_call<ExpectedDetail::expected_call_result<F&&, Args&&...>, E> call;
+    return ExpectedDetail::expected_invoke<call, E>(std::integral_constant<bool, noexcept(std::declval<F>()(std::declval<Args>()...))>(), std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+// The reverse of make_expected_from_call, for callers which need exceptions. Errors are thrown wrapped in a
+// bad_expected_access, except for std::exception_ptr which rethrows the original exception.
+template <class E>
+class bad_expected_access : public std::exception {
+public:
+    explicit bad_expected_access(E e) : val(std::move(e)) { }
+    const char* what() const noexcept override { return "bad expected access"; }
+    const E& error() const & { return val; }
+    E& error() & { return val; }
+
+private:
+    E val;
+};
+
+template <class E> void throw_expected_error(const E& e)
+{
+#if WTF_EXPECTED_EXCEPTIONS
+    throw bad_expected_access<E>(e);
+#else
+    (void)e;
+    unexpected_fail();
+#endif
+}
+
+inline void throw_expected_error(const std::exception_ptr& e)
+{
+#if WTF_EXPECTED_EXCEPTIONS
+    std::rethrow_exception(e);
+#else
+    (void)e;
+    unexpected_fail();
+#endif
+}
+
+template <class T, class E> const T& value_or_throw(const expected<T, E>& e) { if (!e) throw_expected_error(e.error()); return *e; }
+template <class T, class E> T value_or_throw(expected<T, E>&& e) { if (!e) throw_expected_error(e.error()); return *std::move(e); }
+template <class E> void value_or_throw(const expected<void, E>& e) { if (!e) throw_expected_error(e.error()); }
+template <class E> void value_or_throw(expected<void, E>&& e) { if (!e) throw_expected_error(e.error()); }
+
+inline expected<void, WTF::nullopt_t> make_expected() { return expected<void, WTF::nullopt_t>(); }
+
+WTF_EXPECTED_NAMESPACE_END
 
 } // namespace WTF
 
@@ -424,6 +841,13 @@ template <class T, class E> struct hash<WTF::expected<T, E>>
     result_type operator()(argument_type const& e) const { return e ? hash<typename argument_type::value_type>{ }(e.value()) : hash<typename argument_type::error_type>{ }(e.error()); }
 };
 
+template <class T, class E> struct hash<WTF::expected<T&, E>>
+{
+    typedef WTF::expected<T&, E> argument_type;
+    typedef std::size_t result_type;
+    result_type operator()(argument_type const& e) const { return e ? hash<std::remove_cv_t<T>>{ }(*e) : hash<typename argument_type::error_type>{ }(e.error()); }
+};
+
 template <class E> struct hash<WTF::expected<void, E>>
 {
     typedef WTF::expected<void, E> argument_type;
@@ -440,5 +864,10 @@ using WTF::unexpect;
 using WTF::expected;
 using WTF::make_expected;
 using WTF::make_expected_from_error;
+using WTF::make_expected_from_call;
+using WTF::value_or_throw;
+using WTF::expected_violation;
+using WTF::expected_violation_handler;
+using WTF::set_expected_violation_handler;
 
 #endif
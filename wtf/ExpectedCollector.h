@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// expected_collector gathers the errors from a batch of expected results instead of stopping at the
+// first one. Errors are kept in a fixed-capacity inline buffer, and the ones which don't fit are only
+// counted, so collecting never allocates. The single allocation happens in finish(), which hands the
+// retained errors back as an error_summary.
+
+#ifndef ExpectedCollector_h
+#define ExpectedCollector_h
+
+#include <wtf/Expected.h>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace WTF {
+
+WTF_EXPECTED_NAMESPACE_BEGIN
+
+template <class E>
+struct error_summary {
+    std::vector<E> errors; // The first errors which were recorded, in order.
+    std::size_t dropped; // Errors which were recorded after the collector was full.
+
+    std::size_t count() const { return errors.size() + dropped; }
+};
+
+template <class E> bool operator==(const error_summary<E>& x, const error_summary<E>& y) { return x.dropped == y.dropped && x.errors == y.errors; }
+template <class E> bool operator!=(const error_summary<E>& x, const error_summary<E>& y) { return !(x == y); }
+
+template <class E, std::size_t N>
+class expected_collector {
+    static_assert(N > 0, "expected_collector needs room for at least one error");
+
+public:
+    typedef E error_type;
+
+    expected_collector() noexcept : held(0), overflow(0) { }
+    expected_collector(const expected_collector&) = delete;
+    expected_collector& operator=(const expected_collector&) = delete;
+    ~expected_collector() { clear(); }
+
+    static constexpr std::size_t capacity() { return N; }
+    std::size_t size() const { return held; }
+    std::size_t dropped() const { return overflow; }
+    std::size_t error_count() const { return held + overflow; }
+    bool empty() const { return !error_count(); }
+
+    const E* begin() const { return slot(0); }
+    const E* end() const { return slot(held); }
+
+    void record(const E& e) noexcept(std::is_nothrow_copy_constructible<E>::value)
+    {
+        if (held < N) {
+            ::new (slot(held)) E(e);
+            ++held;
+        } else
+            ++overflow;
+    }
+    void record(E&& e) noexcept(std::is_nothrow_move_constructible<E>::value)
+    {
+        if (held < N) {
+            ::new (slot(held)) E(std::move(e));
+            ++held;
+        } else
+            ++overflow;
+    }
+
+    // Passes a success's value to sink, or records a failure's error. Returns whether e held a value.
+    template <class T, class Sink> bool collect(expected<T, E>&& e, Sink&& sink)
+    {
+        if (!e) {
+            record(std::move(e).error());
+            return false;
+        }
+        std::forward<Sink>(sink)(*std::move(e));
+        return true;
+    }
+    template <class T, class Sink> bool collect(const expected<T, E>& e, Sink&& sink)
+    {
+        if (!e) {
+            record(e.error());
+            return false;
+        }
+        std::forward<Sink>(sink)(*e);
+        return true;
+    }
+    template <class Sink> bool collect(expected<void, E>&& e, Sink&& sink)
+    {
+        if (!e) {
+            record(std::move(e).error());
+            return false;
+        }
+        std::forward<Sink>(sink)();
+        return true;
+    }
+    template <class Sink> bool collect(const expected<void, E>& e, Sink&& sink)
+    {
+        if (!e) {
+            record(e.error());
+            return false;
+        }
+        std::forward<Sink>(sink)();
+        return true;
+    }
+    bool collect(expected<void, E>&& e) { return collect(std::move(e), [] { }); }
+    bool collect(const expected<void, E>& e) { return collect(e, [] { }); }
+
+    // Moves o's errors after this one's. Whatever doesn't fit is counted as dropped.
+    template <std::size_t M> void merge(expected_collector<E, M>&& o)
+    {
+        for (std::size_t i = 0; i < o.held; ++i)
+            record(std::move(*o.slot(i)));
+        overflow += o.overflow;
+        o.clear();
+    }
+
+    // Succeeds if nothing was recorded. Either way, the collector is empty afterwards.
+    expected<void, error_summary<E>> finish()
+    {
+        if (empty())
+            return { };
+        error_summary<E> summary { { }, overflow };
+        summary.errors.reserve(held);
+        for (std::size_t i = 0; i < held; ++i)
+            summary.errors.push_back(std::move(*slot(i)));
+        clear();
+        return make_unexpected(std::move(summary));
+    }
+
+    void clear()
+    {
+        for (std::size_t i = 0; i < held; ++i)
+            slot(i)->~E();
+        held = 0;
+        overflow = 0;
+    }
+
+private:
+    template <class, std::size_t> friend class expected_collector;
+    template <class, std::size_t> friend class sharded_expected_collector;
+
+    E* slot(std::size_t i) { return reinterpret_cast<E*>(buffer) + i; }
+    const E* slot(std::size_t i) const { return reinterpret_cast<const E*>(buffer) + i; }
+
+    alignas(E) unsigned char buffer[N * sizeof(E)];
+    std::size_t held;
+    std::size_t overflow;
+};
+
+// One expected_collector per worker thread. Each worker only touches its own shard, so collecting
+// needs no locking; finish() merges the shards once the workers are done.
+template <class E, std::size_t N>
+class sharded_expected_collector {
+public:
+    typedef expected_collector<E, N> shard_type;
+
+    explicit sharded_expected_collector(std::size_t count)
+        : shards(new padded_shard[count])
+        , count(count)
+    {
+    }
+
+    std::size_t shard_count() const { return count; }
+    shard_type& shard(std::size_t index) { return shards[index].collector; }
+    const shard_type& shard(std::size_t index) const { return shards[index].collector; }
+
+    // Must not race with the workers. Errors keep their order within each shard, and shards are
+    // concatenated in index order, so the summary can hold up to shard_count() * N errors.
+    expected<void, error_summary<E>> finish()
+    {
+        std::size_t held = 0;
+        std::size_t dropped = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            held += shard(i).size();
+            dropped += shard(i).dropped();
+        }
+        if (!held && !dropped)
+            return { };
+        error_summary<E> summary { { }, dropped };
+        summary.errors.reserve(held);
+        for (std::size_t i = 0; i < count; ++i) {
+            shard_type& collector = shard(i);
+            for (std::size_t j = 0; j < collector.held; ++j)
+                summary.errors.push_back(std::move(*collector.slot(j)));
+            collector.clear();
+        }
+        return make_unexpected(std::move(summary));
+    }
+
+private:
+    // Keep each shard on its own cache line so that workers don't false-share.
+    struct alignas(64) padded_shard {
+        shard_type collector;
+    };
+
+    std::unique_ptr<padded_shard[]> shards;
+    std::size_t count;
+};
+
+WTF_EXPECTED_NAMESPACE_END
+
+} // namespace WTF
+
+using WTF::error_summary;
+using WTF::expected_collector;
+using WTF::sharded_expected_collector;
+
+#endif
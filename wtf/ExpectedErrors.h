@@ -0,0 +1,498 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// expected<T, errors<E1, E2, ...>> can fail in several distinct ways. Unlike expected<T, std::variant<...>>,
+// the value and every error share one union, and a single byte says which of them is live: 0 for the
+// value, i + 1 for the i-th error. Checking for an error is then one test, and there is no padding
+// between a has-value flag and a variant index. When every alternative is trivially copyable and
+// destructible, so is construction and destruction of the expected, as with expected_constexpr_base.
+//
+// Error types must be distinct, so that they can be named by type. expected<T&, errors<...>> isn't supported.
+
+#ifndef ExpectedErrors_h
+#define ExpectedErrors_h
+
+#include <wtf/Expected.h>
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace WTF {
+
+WTF_EXPECTED_NAMESPACE_BEGIN
+
+template <class... Es>
+struct errors {
+    static_assert(sizeof...(Es) > 0, "errors needs at least one error type");
+    static_assert(sizeof...(Es) < 255, "errors' alternatives are indexed by a byte");
+};
+
+namespace ExpectedDetail {
+
+// Stands in for the value of expected<void, errors<...>>.
+struct expected_errors_void { };
+
+// Where E is in Es, or sizeof...(Es) if it isn't.
+template <class E, class... Es>
+constexpr std::size_t expected_errors_index()
+{
+    constexpr bool matches[] = { std::is_same<E, Es>::value... };
+    for (std::size_t i = 0; i < sizeof...(Es); ++i) {
+        if (matches[i])
+            return i;
+    }
+    return sizeof...(Es);
+}
+
+template <class E, class... Es>
+constexpr bool expected_errors_contains() { return expected_errors_index<E, Es...>() < sizeof...(Es); }
+
+template <class... Es>
+constexpr bool expected_errors_distinct()
+{
+    constexpr std::size_t first[] = { expected_errors_index<Es, Es...>()... };
+    for (std::size_t i = 0; i < sizeof...(Es); ++i) {
+        if (first[i] != i)
+            return false;
+    }
+    return true;
+}
+
+// Calls f with std::integral_constant<std::size_t, index>, for index in [I, N).
+template <std::size_t I, std::size_t N, class F>
+constexpr decltype(auto) expected_errors_dispatch(std::size_t index, F&& f)
+{
+    if constexpr (I + 1 == N)
+        return f(std::integral_constant<std::size_t, I>());
+    else {
+        if (index == I)
+            return f(std::integral_constant<std::size_t, I>());
+        return expected_errors_dispatch<I + 1, N>(index, std::forward<F>(f));
+    }
+}
+
+template <bool trivial, class... As>
+union expected_alternatives {
+    char dummy;
+    constexpr expected_alternatives() noexcept : dummy() { }
+};
+
+template <class A, class... As>
+union expected_alternatives<true, A, As...> {
+    char dummy;
+    A head;
+    expected_alternatives<true, As...> tail;
+    constexpr expected_alternatives() noexcept : dummy() { }
+    template <class... Args> constexpr expected_alternatives(std::in_place_index_t<0>, Args&&... args) : head(std::forward<Args>(args)...) { }
+    template <std::size_t I, class... Args, std::enable_if_t<(I > 0), int> = 0> constexpr expected_alternatives(std::in_place_index_t<I>, Args&&... args) : tail(std::in_place_index<I - 1>, std::forward<Args>(args)...) { }
+    ~expected_alternatives() = default;
+    template <std::size_t I> constexpr const auto& get() const noexcept { if constexpr (!I) return head; else return tail.template get<I - 1>(); }
+    template <std::size_t I> constexpr auto& get() noexcept { if constexpr (!I) return head; else return tail.template get<I - 1>(); }
+};
+
+template <class A, class... As>
+union expected_alternatives<false, A, As...> {
+    char dummy;
+    A head;
+    expected_alternatives<false, As...> tail;
+    constexpr expected_alternatives() noexcept : dummy() { }
+    template <class... Args> constexpr expected_alternatives(std::in_place_index_t<0>, Args&&... args) : head(std::forward<Args>(args)...) { }
+    template <std::size_t I, class... Args, std::enable_if_t<(I > 0), int> = 0> constexpr expected_alternatives(std::in_place_index_t<I>, Args&&... args) : tail(std::in_place_index<I - 1>, std::forward<Args>(args)...) { }
+    ~expected_alternatives() { }
+    template <std::size_t I> constexpr const auto& get() const noexcept { if constexpr (!I) return head; else return tail.template get<I - 1>(); }
+    template <std::size_t I> constexpr auto& get() noexcept { if constexpr (!I) return head; else return tail.template get<I - 1>(); }
+};
+
+static constexpr enum class expected_errors_construct_tag_type { } expected_errors_construct_tag{ };
+
+// Alternative 0 is the value, alternative i + 1 the i-th error.
+template <bool trivial, class T, class... Es>
+struct expected_errors_storage {
+    static constexpr std::size_t alternative_count = sizeof...(Es) + 1;
+    template <std::size_t I> using alternative_type = std::tuple_element_t<I, std::tuple<T, Es...>>;
+    static constexpr bool nothrow_move_alternative(std::size_t i)
+    {
+        constexpr bool nothrow[] = { std::is_nothrow_move_constructible<T>::value, std::is_nothrow_move_constructible<Es>::value... };
+        return nothrow[i];
+    }
+
+    expected_alternatives<trivial, T, Es...> s;
+    unsigned char index;
+
+    template <std::size_t I, class... Args> constexpr expected_errors_storage(std::in_place_index_t<I> tag, Args&&... args) : s(tag, std::forward<Args>(args)...), index(I) { }
+    // For conversions, whose alternative is only known at runtime. If construct throws, nothing needs destroying.
+    template <class Construct> expected_errors_storage(expected_errors_construct_tag_type, Construct&& construct) : s(), index(0) { construct(*this); }
+
+    template <std::size_t I, class... Args> void construct(Args&&... args)
+    {
+        ::new (&s.template get<I>()) alternative_type<I>(std::forward<Args>(args)...);
+        index = I;
+    }
+    template <class Storage> void copy_from(const Storage& o)
+    {
+        expected_errors_dispatch<0, alternative_count>(o.index, [&](auto i) {
+            this->template construct<decltype(i)::value>(o.s.template get<decltype(i)::value>());
+        });
+    }
+    template <class Storage> void move_from(Storage& o)
+    {
+        expected_errors_dispatch<0, alternative_count>(o.index, [&](auto i) {
+            this->template construct<decltype(i)::value>(std::move(o.s.template get<decltype(i)::value>()));
+        });
+    }
+    void destroy() noexcept
+    {
+        if constexpr (!trivial) {
+            expected_errors_dispatch<0, alternative_count>(index, [&](auto i) {
+                typedef alternative_type<decltype(i)::value> type;
+                s.template get<decltype(i)::value>().type::~type();
+            });
+        }
+    }
+};
+
+template <class T, class... Es>
+struct expected_errors_constexpr_base : expected_errors_storage<true, T, Es...> {
+    using expected_errors_storage<true, T, Es...>::expected_errors_storage;
+};
+
+template <class T, class... Es>
+struct expected_errors_base : expected_errors_storage<false, T, Es...> {
+    typedef expected_errors_storage<false, T, Es...> storage;
+    using storage::storage;
+    expected_errors_base(const expected_errors_base& o) noexcept(std::is_nothrow_copy_constructible<T>::value && (std::is_nothrow_copy_constructible<Es>::value && ...))
+        : storage(expected_errors_construct_tag, [&](storage& s) { s.copy_from(o); }) { }
+    expected_errors_base(expected_errors_base&& o) noexcept(std::is_nothrow_move_constructible<T>::value && (std::is_nothrow_move_constructible<Es>::value && ...))
+        : storage(expected_errors_construct_tag, [&](storage& s) { s.move_from(o); }) { }
+    ~expected_errors_base() { storage::destroy(); }
+};
+
+template <class T>
+constexpr bool expected_errors_trivial() { return std::is_trivially_copy_constructible<T>::value && std::is_trivially_move_constructible<T>::value && std::is_trivially_destructible<T>::value; }
+
+template <class T, class... Es>
+using expected_errors_base_select = typename std::conditional<
+    expected_errors_trivial<T>() && (expected_errors_trivial<Es>() && ...),
+    expected_errors_constexpr_base<T, Es...>,
+    expected_errors_base<T, Es...>
+>::type;
+
+// Swaps x and y, which hold different alternatives, the same way expected's swap does: one goes through a
+// temporary, preferably whichever moves back without throwing, and is put back if moving the other over throws.
+template <class Base>
+void expected_errors_swap_alternatives(Base& x, Base& y)
+{
+    if (!Base::nothrow_move_alternative(y.index) && Base::nothrow_move_alternative(x.index))
+        return expected_errors_swap_alternatives(y, x);
+    Base moved(std::move(y));
+    y.destroy();
+    expected_construct_or_restore([&] { y.move_from(x); }, [&] { y.move_from(moved); });
+    x.destroy();
+    expected_rebuild([&] { x.move_from(moved); });
+}
+
+template <class Self, class A> constexpr decltype(auto) expected_errors_forward(A& a)
+{
+    if constexpr (std::is_lvalue_reference<Self>::value)
+        return a;
+    else
+        return std::move(a);
+}
+
+} // namespace ExpectedDetail
+
+template <class T, class... Es>
+class expected<T, errors<Es...>>
+    : private ExpectedDetail::expected_errors_base_select<std::remove_const_t<T>, Es...>
+    , private ExpectedDetail::expected_copy_control<std::is_copy_constructible<T>::value && (std::is_copy_constructible<Es>::value && ...)>
+    , private ExpectedDetail::expected_check_state {
+    typedef ExpectedDetail::expected_errors_base_select<std::remove_const_t<T>, Es...> base;
+    static_assert(ExpectedDetail::expected_errors_distinct<Es...>(), "errors' types must be distinct");
+
+public:
+    typedef std::remove_const_t<T> value_type;
+    typedef errors<Es...> error_type;
+    static constexpr std::size_t error_count = sizeof...(Es);
+    template <class Err> static constexpr bool can_hold_error = ExpectedDetail::expected_errors_contains<Err, Es...>();
+
+private:
+    typedef expected<value_type, error_type> type;
+    template <class Err> static constexpr std::size_t alternative_of = 1 + ExpectedDetail::expected_errors_index<Err, Es...>();
+    static constexpr bool nothrow_copy = std::is_nothrow_copy_constructible<value_type>::value && (std::is_nothrow_copy_constructible<Es>::value && ...);
+    static constexpr bool nothrow_move = std::is_nothrow_move_constructible<value_type>::value && (std::is_nothrow_move_constructible<Es>::value && ...);
+    static constexpr bool nothrow_swap = nothrow_move && std::is_nothrow_swappable<value_type>::value && (std::is_nothrow_swappable<Es>::value && ...);
+
+public:
+    template <class U> struct rebind { typedef expected<U, error_type> type; };
+
+    constexpr expected() noexcept(std::is_nothrow_default_constructible<value_type>::value) : base(std::in_place_index<0>) { }
+    expected(const expected&) = default;
+    expected(expected&&) = default;
+    constexpr expected(const value_type& v) noexcept(std::is_nothrow_copy_constructible<value_type>::value) : base(std::in_place_index<0>, v) { }
+    constexpr expected(value_type&& v) noexcept(std::is_nothrow_move_constructible<value_type>::value) : base(std::in_place_index<0>, std::move(v)) { }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr expected(const unexpected_type<Err>& u) noexcept(std::is_nothrow_copy_constructible<Err>::value) : base(std::in_place_index<alternative_of<Err>>, u.value()) { }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_move_constructible<Err>::value) : base(std::in_place_index<alternative_of<Err>>, std::move(u.value())) { }
+
+    // Widening conversions, from results whose errors are all among Es.
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> expected(const expected<value_type, Err>& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(*o); else s.template construct<alternative_of<Err>>(o.error()); }) { }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> expected(expected<value_type, Err>&& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(std::move(*o)); else s.template construct<alternative_of<Err>>(std::move(o.error())); }) { }
+    template <class... Fs, std::enable_if_t<(can_hold_error<Fs> && ...), int> = 0> expected(const expected<value_type, errors<Fs...>>& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(*o); else o.visit_error([&](const auto& e) { s.template construct<alternative_of<std::decay_t<decltype(e)>>>(e); }); }) { }
+    template <class... Fs, std::enable_if_t<(can_hold_error<Fs> && ...), int> = 0> expected(expected<value_type, errors<Fs...>>&& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(std::move(*o)); else std::move(o).visit_error([&](auto&& e) { s.template construct<alternative_of<std::decay_t<decltype(e)>>>(std::move(e)); }); }) { }
+
+#if WTF_EXPECTED_CHECKED
+    ~expected() { this->check_destruction(!base::index); }
+#else
+    ~expected() = default;
+#endif
+
+    expected& operator=(ExpectedDetail::expected_copy_assignment_source<expected, std::is_copy_constructible<T>::value && (std::is_copy_constructible<Es>::value && ...)> e) noexcept(nothrow_copy && nothrow_swap) { type(e).swap(*this); return *this; }
+    expected& operator=(expected&& e) noexcept(nothrow_move && nothrow_swap) { type(std::move(e)).swap(*this); return *this; }
+    template <class U, class = std::enable_if_t<std::is_constructible<type, U&&>::value>> expected& operator=(U&& u) noexcept(std::is_nothrow_constructible<type, U&&>::value && nothrow_swap) { type(std::forward<U>(u)).swap(*this); return *this; }
+
+    void swap(expected& o) noexcept(nothrow_swap)
+    {
+        this->swap_check_state(o);
+        if (base::index == o.index) {
+            ExpectedDetail::expected_errors_dispatch<0, base::alternative_count>(base::index, [&](auto i) {
+                using std::swap;
+                swap(base::s.template get<decltype(i)::value>(), o.s.template get<decltype(i)::value>());
+            });
+            return;
+        }
+        ExpectedDetail::expected_errors_swap_alternatives(static_cast<base&>(*this), static_cast<base&>(o));
+    }
+
+    constexpr const value_type* operator->() const noexcept { this->require_checked(); return &base::s.template get<0>(); }
+    value_type* operator->() noexcept { this->require_checked(); return &base::s.template get<0>(); }
+    constexpr const value_type& operator*() const & noexcept { this->require_checked(); return base::s.template get<0>(); }
+    value_type& operator*() & noexcept { this->require_checked(); return base::s.template get<0>(); }
+    constexpr const value_type&& operator*() const && noexcept { this->require_checked(); return std::move(base::s.template get<0>()); }
+    constexpr value_type&& operator*() && noexcept { this->require_checked(); return std::move(base::s.template get<0>()); }
+    constexpr explicit operator bool() const noexcept { this->mark_checked(); return !base::index; }
+    constexpr bool has_value() const noexcept { this->mark_checked(); return !base::index; }
+    constexpr const value_type& value() const & noexcept { this->require_checked(); return !base::index ? **this : (unexpected_fail(), **this); }
+    constexpr value_type& value() & noexcept { this->require_checked(); return !base::index ? **this : (unexpected_fail(), **this); }
+    constexpr const value_type&& value() const && noexcept { this->require_checked(); return !base::index ? std::move(**this) : (unexpected_fail(), std::move(**this)); }
+    constexpr value_type&& value() && noexcept { this->require_checked(); return !base::index ? std::move(**this) : (unexpected_fail(), std::move(**this)); }
+    template <class U> constexpr value_type value_or(U&& u) const & noexcept(std::is_nothrow_copy_constructible<value_type>::value && std::is_nothrow_constructible<value_type, U&&>::value) { this->mark_checked(); return !base::index ? **this : static_cast<value_type>(std::forward<U>(u)); }
+    template <class U> value_type value_or(U&& u) && noexcept(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_constructible<value_type, U&&>::value) { this->mark_checked(); return !base::index ? std::move(**this) : static_cast<value_type>(std::forward<U>(u)); }
+
+    // The held error's position in Es.
+    constexpr std::size_t error_index() const noexcept { this->require_checked(); return base::index ? base::index - 1u : (unexpected_fail(), 0u); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr bool holds_error() const noexcept { this->mark_checked(); return base::index == alternative_of<Err>; }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr const Err& error() const & noexcept { this->require_checked(); return holds_error<Err>() ? base::s.template get<alternative_of<Err>>() : (unexpected_fail(), base::s.template get<alternative_of<Err>>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr Err& error() & noexcept { this->require_checked(); return holds_error<Err>() ? base::s.template get<alternative_of<Err>>() : (unexpected_fail(), base::s.template get<alternative_of<Err>>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr const Err&& error() const && noexcept { this->require_checked(); return std::move(error<Err>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr Err&& error() && noexcept { this->require_checked(); return std::move(error<Err>()); }
+
+    // Calls f with the held error, which must exist.
+    template <class F> constexpr decltype(auto) visit_error(F&& f) const & { return visit_from<1>(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit_error(F&& f) & { return visit_from<1>(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit_error(F&& f) && { return visit_from<1>(std::move(*this), std::forward<F>(f)); }
+    // Calls f with the value or the held error. f can't tell them apart if value_type is also an error type.
+    template <class F> constexpr decltype(auto) visit(F&& f) const & { return visit_from<0>(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit(F&& f) & { return visit_from<0>(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit(F&& f) && { return visit_from<0>(std::move(*this), std::forward<F>(f)); }
+
+private:
+    template <std::size_t first, class Self, class F> static constexpr decltype(auto) visit_from(Self&& self, F&& f)
+    {
+        if (first)
+            self.require_checked();
+        else
+            self.mark_checked();
+        if (first && !self.index)
+            unexpected_fail();
+        return ExpectedDetail::expected_errors_dispatch<first, base::alternative_count>(self.index, [&](auto i) -> decltype(auto) {
+            return std::forward<F>(f)(ExpectedDetail::expected_errors_forward<Self>(self.s.template get<decltype(i)::value>()));
+        });
+    }
+};
+
+template <class... Es>
+class expected<void, errors<Es...>>
+    : private ExpectedDetail::expected_errors_base_select<ExpectedDetail::expected_errors_void, Es...>
+    , private ExpectedDetail::expected_copy_control<(std::is_copy_constructible<Es>::value && ...)>
+    , private ExpectedDetail::expected_check_state {
+    typedef ExpectedDetail::expected_errors_base_select<ExpectedDetail::expected_errors_void, Es...> base;
+    static_assert(ExpectedDetail::expected_errors_distinct<Es...>(), "errors' types must be distinct");
+
+public:
+    typedef void value_type;
+    typedef errors<Es...> error_type;
+    static constexpr std::size_t error_count = sizeof...(Es);
+    template <class Err> static constexpr bool can_hold_error = ExpectedDetail::expected_errors_contains<Err, Es...>();
+
+private:
+    typedef expected<value_type, error_type> type;
+    template <class Err> static constexpr std::size_t alternative_of = 1 + ExpectedDetail::expected_errors_index<Err, Es...>();
+    static constexpr bool nothrow_copy = (std::is_nothrow_copy_constructible<Es>::value && ...);
+    static constexpr bool nothrow_move = (std::is_nothrow_move_constructible<Es>::value && ...);
+    static constexpr bool nothrow_swap = nothrow_move && (std::is_nothrow_swappable<Es>::value && ...);
+
+public:
+    template <class U> struct rebind { typedef expected<U, error_type> type; };
+
+    constexpr expected() noexcept : base(std::in_place_index<0>) { }
+    expected(const expected&) = default;
+    expected(expected&&) = default;
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr expected(const unexpected_type<Err>& u) noexcept(std::is_nothrow_copy_constructible<Err>::value) : base(std::in_place_index<alternative_of<Err>>, u.value()) { }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr expected(unexpected_type<Err>&& u) noexcept(std::is_nothrow_move_constructible<Err>::value) : base(std::in_place_index<alternative_of<Err>>, std::move(u.value())) { }
+
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> expected(const expected<void, Err>& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(); else s.template construct<alternative_of<Err>>(o.error()); }) { }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> expected(expected<void, Err>&& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(); else s.template construct<alternative_of<Err>>(std::move(o.error())); }) { }
+    template <class... Fs, std::enable_if_t<(can_hold_error<Fs> && ...), int> = 0> expected(const expected<void, errors<Fs...>>& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(); else o.visit_error([&](const auto& e) { s.template construct<alternative_of<std::decay_t<decltype(e)>>>(e); }); }) { }
+    template <class... Fs, std::enable_if_t<(can_hold_error<Fs> && ...), int> = 0> expected(expected<void, errors<Fs...>>&& o)
+        : base(ExpectedDetail::expected_errors_construct_tag, [&](auto& s) { if (o) s.template construct<0>(); else std::move(o).visit_error([&](auto&& e) { s.template construct<alternative_of<std::decay_t<decltype(e)>>>(std::move(e)); }); }) { }
+
+#if WTF_EXPECTED_CHECKED
+    ~expected() { this->check_destruction(!base::index); }
+#else
+    ~expected() = default;
+#endif
+
+    expected& operator=(ExpectedDetail::expected_copy_assignment_source<expected, (std::is_copy_constructible<Es>::value && ...)> e) noexcept(nothrow_copy && nothrow_swap) { type(e).swap(*this); return *this; }
+    expected& operator=(expected&& e) noexcept(nothrow_move && nothrow_swap) { type(std::move(e)).swap(*this); return *this; }
+    template <class U, class = std::enable_if_t<std::is_constructible<type, U&&>::value>> expected& operator=(U&& u) noexcept(std::is_nothrow_constructible<type, U&&>::value && nothrow_swap) { type(std::forward<U>(u)).swap(*this); return *this; }
+
+    void swap(expected& o) noexcept(nothrow_swap)
+    {
+        this->swap_check_state(o);
+        if (base::index == o.index) {
+            ExpectedDetail::expected_errors_dispatch<0, base::alternative_count>(base::index, [&](auto i) {
+                using std::swap;
+                swap(base::s.template get<decltype(i)::value>(), o.s.template get<decltype(i)::value>());
+            });
+            return;
+        }
+        ExpectedDetail::expected_errors_swap_alternatives(static_cast<base&>(*this), static_cast<base&>(o));
+    }
+
+    constexpr explicit operator bool() const noexcept { this->mark_checked(); return !base::index; }
+    constexpr bool has_value() const noexcept { this->mark_checked(); return !base::index; }
+    void value() const noexcept { this->require_checked(); if (base::index) unexpected_fail(); }
+
+    constexpr std::size_t error_index() const noexcept { this->require_checked(); return base::index ? base::index - 1u : (unexpected_fail(), 0u); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr bool holds_error() const noexcept { this->mark_checked(); return base::index == alternative_of<Err>; }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr const Err& error() const & noexcept { this->require_checked(); return holds_error<Err>() ? base::s.template get<alternative_of<Err>>() : (unexpected_fail(), base::s.template get<alternative_of<Err>>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr Err& error() & noexcept { this->require_checked(); return holds_error<Err>() ? base::s.template get<alternative_of<Err>>() : (unexpected_fail(), base::s.template get<alternative_of<Err>>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr const Err&& error() const && noexcept { this->require_checked(); return std::move(error<Err>()); }
+    template <class Err, std::enable_if_t<can_hold_error<Err>, int> = 0> constexpr Err&& error() && noexcept { this->require_checked(); return std::move(error<Err>()); }
+
+    // There is no visit(): a void value has nothing to pass.
+    template <class F> constexpr decltype(auto) visit_error(F&& f) const & { return visit_error_from(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit_error(F&& f) & { return visit_error_from(*this, std::forward<F>(f)); }
+    template <class F> constexpr decltype(auto) visit_error(F&& f) && { return visit_error_from(std::move(*this), std::forward<F>(f)); }
+
+private:
+    template <class Self, class F> static constexpr decltype(auto) visit_error_from(Self&& self, F&& f)
+    {
+        self.require_checked();
+        if (!self.index)
+            unexpected_fail();
+        return ExpectedDetail::expected_errors_dispatch<1, base::alternative_count>(self.index, [&](auto i) -> decltype(auto) {
+            return std::forward<F>(f)(ExpectedDetail::expected_errors_forward<Self>(self.s.template get<decltype(i)::value>()));
+        });
+    }
+};
+
+namespace ExpectedDetail {
+
+template <class T, class... Es>
+constexpr bool expected_errors_equal_errors(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y)
+{
+    return x.error_index() == y.error_index() && x.visit_error([&](const auto& e) { return e == y.template error<std::decay_t<decltype(e)>>(); });
+}
+
+// Errors order by their position in Es, then by their own operator<.
+template <class T, class... Es>
+constexpr bool expected_errors_less_errors(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y)
+{
+    if (x.error_index() != y.error_index())
+        return x.error_index() < y.error_index();
+    return x.visit_error([&](const auto& e) { return e < y.template error<std::decay_t<decltype(e)>>(); });
+}
+
+} // namespace ExpectedDetail
+
+template <class T, class... Es> constexpr bool operator==(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y) { return bool(x) == bool(y) && (x ? *x == *y : ExpectedDetail::expected_errors_equal_errors(x, y)); }
+template <class... Es> constexpr bool operator==(const expected<void, errors<Es...>>& x, const expected<void, errors<Es...>>& y) { return bool(x) == bool(y) && (x || ExpectedDetail::expected_errors_equal_errors(x, y)); }
+template <class T, class... Es, class Err> constexpr bool operator==(const expected<T, errors<Es...>>& x, const unexpected_type<Err>& y) { return x.template holds_error<Err>() && x.template error<Err>() == y.value(); }
+template <class T, class... Es, class Err> constexpr bool operator==(const unexpected_type<Err>& x, const expected<T, errors<Es...>>& y) { return y == x; }
+template <class T, class... Es, class Err> constexpr bool operator!=(const expected<T, errors<Es...>>& x, const unexpected_type<Err>& y) { return !(x == y); }
+template <class T, class... Es, class Err> constexpr bool operator!=(const unexpected_type<Err>& x, const expected<T, errors<Es...>>& y) { return !(x == y); }
+
+// These take precedence over Expected.h's, which rely on a single error().
+template <class T, class... Es> constexpr bool operator<(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y) { return (!bool(x) && bool(y)) ? false : ((bool(x) && !bool(y)) ? true : ((bool(x) && bool(y)) ? *x < *y : ExpectedDetail::expected_errors_less_errors(x, y))); }
+template <class T, class... Es> constexpr bool operator>(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y) { return !(x == y) && !(x < y); }
+template <class T, class... Es> constexpr bool operator<=(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y) { return (x == y) || (x < y); }
+template <class T, class... Es> constexpr bool operator>=(const expected<T, errors<Es...>>& x, const expected<T, errors<Es...>>& y) { return (x == y) || (x > y); }
+template <class... Es> constexpr bool operator<(const expected<void, errors<Es...>>& x, const expected<void, errors<Es...>>& y) { return (!bool(x) && bool(y)) ? false : ((bool(x) && !bool(y)) ? true : ((bool(x) && bool(y)) ? false : ExpectedDetail::expected_errors_less_errors(x, y))); }
+template <class... Es> constexpr bool operator>(const expected<void, errors<Es...>>& x, const expected<void, errors<Es...>>& y) { return !(x == y) && !(x < y); }
+template <class... Es> constexpr bool operator<=(const expected<void, errors<Es...>>& x, const expected<void, errors<Es...>>& y) { return (x == y) || (x < y); }
+template <class... Es> constexpr bool operator>=(const expected<void, errors<Es...>>& x, const expected<void, errors<Es...>>& y) { return (x == y) || (x > y); }
+
+// Throws whichever error is held, the same way value_or_throw does for a single error type.
+template <class T, class... Es> const T& value_or_throw(const expected<T, errors<Es...>>& e) { if (!e) e.visit_error([](const auto& err) { throw_expected_error(err); }); return *e; }
+template <class T, class... Es> T value_or_throw(expected<T, errors<Es...>>&& e) { if (!e) e.visit_error([](const auto& err) { throw_expected_error(err); }); return *std::move(e); }
+template <class... Es> void value_or_throw(const expected<void, errors<Es...>>& e) { if (!e) e.visit_error([](const auto& err) { throw_expected_error(err); }); }
+template <class... Es> void value_or_throw(expected<void, errors<Es...>>&& e) { if (!e) e.visit_error([](const auto& err) { throw_expected_error(err); }); }
+
+WTF_EXPECTED_NAMESPACE_END
+
+} // namespace WTF
+
+namespace std {
+
+template <class T, class... Es> struct hash<WTF::expected<T, WTF::errors<Es...>>>
+{
+    typedef WTF::expected<T, WTF::errors<Es...>> argument_type;
+    typedef std::size_t result_type;
+    result_type operator()(argument_type const& e) const { return e ? hash<typename argument_type::value_type>{ }(*e) : e.visit_error([](const auto& err) { return hash<std::decay_t<decltype(err)>>{ }(err); }) ^ (e.error_index() + 1); }
+};
+
+template <class... Es> struct hash<WTF::expected<void, WTF::errors<Es...>>>
+{
+    typedef WTF::expected<void, WTF::errors<Es...>> argument_type;
+    typedef std::size_t result_type;
+    result_type operator()(argument_type const& e) const { return e ? 0 : e.visit_error([](const auto& err) { return hash<std::decay_t<decltype(err)>>{ }(err); }) ^ (e.error_index() + 1); }
+};
+
+}
+
+using WTF::errors;
+
+#endif
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// memoize_expected caches the results of a pure function returning expected<T, E>. It's a sharded,
+// open-addressing hash map with one lock per shard:
+//
+//  - Successes and errors have separate time-to-live, so that transient errors aren't remembered as long
+//    as successes are. By default errors aren't cached at all, beyond sharing them with concurrent callers.
+//  - Concurrent misses on the same key are coalesced: one caller computes, the others wait for its result.
+//  - Eviction is CLOCK (second chance) within each shard, except that errors never get a second chance.
+//
+// Keys are hashed with Hash and compared with ==, so an expected can itself be a key through
+// std::hash<WTF::expected> and expected's comparison operators.
+
+#ifndef MemoizeExpected_h
+#define MemoizeExpected_h
+
+#include <wtf/Expected.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace WTF {
+
+WTF_EXPECTED_NAMESPACE_BEGIN
+
+struct memoize_policy {
+    std::chrono::nanoseconds value_ttl { std::chrono::nanoseconds::max() };
+    std::chrono::nanoseconds error_ttl { 0 };
+    std::size_t capacity { 4096 }; // Entries across all shards. Pending computations may exceed it.
+    std::size_t shards { 16 };
+};
+
+struct memoize_statistics {
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t coalesced; // Misses which waited on another caller's computation instead of computing.
+    std::size_t evictions;
+    std::size_t expirations;
+};
+
+template <class Key, class T, class E, class Hash = std::hash<Key>, class Clock = std::chrono::steady_clock>
+class memoize_expected {
+public:
+    typedef expected<T, E> result_type;
+    typedef std::function<result_type(const Key&)> function_type;
+
+    explicit memoize_expected(function_type function, memoize_policy policy = memoize_policy())
+        : function(std::move(function))
+        , policy(policy)
+        , shardCount(policy.shards ? policy.shards : 1)
+        , shards(new shard[shardCount])
+    {
+        std::size_t perShard = (policy.capacity + shardCount - 1) / shardCount;
+        std::size_t slots = 8;
+        while (slots < perShard * 2)
+            slots *= 2;
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            shards[i].capacity = perShard ? perShard : 1;
+            shards[i].slots.resize(slots);
+        }
+    }
+
+    memoize_expected(const memoize_expected&) = delete;
+    memoize_expected& operator=(const memoize_expected&) = delete;
+
+    result_type operator()(const Key& key)
+    {
+        std::size_t hash = Hash()(key);
+        shard& s = shardFor(hash);
+        std::unique_lock<std::mutex> locker(s.lock);
+        for (;;) {
+            slot* found = s.find(hash, key);
+            if (!found)
+                break;
+            if (found->state == slot_state::pending) {
+                std::shared_ptr<flight> waitingOn = found->pending;
+                ++s.coalesced;
+                s.ready.wait(locker, [&] { return waitingOn->done; });
+                if (waitingOn->result)
+                    return *waitingOn->result;
+                continue; // The computation was abandoned; look again.
+            }
+            if (Clock::now() < found->expiry) {
+                ++s.hits;
+                found->referenced = true;
+                return *found->result;
+            }
+            ++s.expirations;
+            s.remove(*found);
+            break;
+        }
+
+        ++s.misses;
+        std::shared_ptr<flight> computing = std::make_shared<flight>();
+        s.insert(hash, key, computing);
+        completion complete { *this, s, locker, hash, key, computing };
+        locker.unlock();
+        result_type result = function(key);
+        locker.lock();
+        complete.finish(result);
+        return result;
+    }
+
+    memoize_statistics statistics() const
+    {
+        memoize_statistics total { 0, 0, 0, 0, 0 };
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard<std::mutex> locker(shards[i].lock);
+            total.hits += shards[i].hits;
+            total.misses += shards[i].misses;
+            total.coalesced += shards[i].coalesced;
+            total.evictions += shards[i].evictions;
+            total.expirations += shards[i].expirations;
+        }
+        return total;
+    }
+
+    // Cached entries, not counting computations in flight.
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard<std::mutex> locker(shards[i].lock);
+            total += shards[i].live - shards[i].inFlight;
+        }
+        return total;
+    }
+
+    // Drops every cached entry. Computations in flight still complete, and are cached.
+    void clear()
+    {
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard<std::mutex> locker(shards[i].lock);
+            for (slot& entry : shards[i].slots) {
+                if (entry.state == slot_state::ready)
+                    shards[i].remove(entry);
+            }
+        }
+    }
+
+private:
+    typedef typename Clock::time_point time_point;
+
+    enum class slot_state : unsigned char { empty, tombstone, pending, ready };
+
+    // Shared between the caller computing a result and those waiting for it, so that waiters get the
+    // result even if it isn't cached or its slot moves.
+    struct flight {
+        bool done { false };
+        std::optional<result_type> result;
+    };
+
+    struct slot {
+        slot_state state { slot_state::empty };
+        bool referenced { false };
+        std::size_t hash { 0 };
+        time_point expiry { };
+        std::optional<Key> key;
+        std::optional<result_type> result;
+        std::shared_ptr<flight> pending;
+    };
+
+    // On its own cache line, so that threads working on different shards don't false-share.
+    struct alignas(64) shard {
+        mutable std::mutex lock;
+        std::condition_variable ready;
+        std::vector<slot> slots;
+        std::size_t capacity { 0 };
+        std::size_t live { 0 }; // Pending and ready slots.
+        std::size_t inFlight { 0 };
+        std::size_t tombstones { 0 };
+        std::size_t hand { 0 };
+        std::size_t hits { 0 };
+        std::size_t misses { 0 };
+        std::size_t coalesced { 0 };
+        std::size_t evictions { 0 };
+        std::size_t expirations { 0 };
+
+        std::size_t mask() const { return slots.size() - 1; }
+
+        slot* find(std::size_t hash, const Key& key)
+        {
+            for (std::size_t i = hash & mask(), probes = 0; probes < slots.size(); i = (i + 1) & mask(), ++probes) {
+                slot& entry = slots[i];
+                if (entry.state == slot_state::empty)
+                    return nullptr;
+                if (entry.state != slot_state::tombstone && entry.hash == hash && *entry.key == key)
+                    return &entry;
+            }
+            return nullptr;
+        }
+
+        void insert(std::size_t hash, const Key& key, std::shared_ptr<flight> computing)
+        {
+            while (live >= capacity && evict()) { }
+            if ((live + tombstones + 1) * 4 > slots.size() * 3)
+                rehash(live * 4 > slots.size() * 2 ? slots.size() * 2 : slots.size());
+            std::size_t i = hash & mask();
+            while (slots[i].state == slot_state::pending || slots[i].state == slot_state::ready)
+                i = (i + 1) & mask();
+            slot& entry = slots[i];
+            if (entry.state == slot_state::tombstone)
+                --tombstones;
+            entry.state = slot_state::pending;
+            entry.referenced = false;
+            entry.hash = hash;
+            entry.key.emplace(key);
+            entry.result.reset();
+            entry.pending = std::move(computing);
+            ++live;
+            ++inFlight;
+        }
+
+        void remove(slot& entry)
+        {
+            if (entry.state == slot_state::pending)
+                --inFlight;
+            entry.state = slot_state::tombstone;
+            entry.key.reset();
+            entry.result.reset();
+            entry.pending.reset();
+            --live;
+            ++tombstones;
+        }
+
+        // Sweeps the clock hand for a ready entry which hasn't been used since the last sweep. Entries
+        // in flight can't be evicted, so there may be nothing to evict. Returns whether it removed one.
+        bool evict()
+        {
+            for (std::size_t step = 0; step < slots.size() * 2; ++step) {
+                slot& entry = slots[hand];
+                hand = (hand + 1) & mask();
+                if (entry.state != slot_state::ready)
+                    continue;
+                if (entry.referenced && entry.result->has_value()) {
+                    entry.referenced = false;
+                    continue;
+                }
+                ++evictions;
+                remove(entry);
+                return true;
+            }
+            return false;
+        }
+
+        void rehash(std::size_t size)
+        {
+            std::vector<slot> old(size);
+            old.swap(slots);
+            tombstones = 0;
+            hand = 0;
+            for (slot& entry : old) {
+                if (entry.state != slot_state::pending && entry.state != slot_state::ready)
+                    continue;
+                std::size_t i = entry.hash & mask();
+                while (slots[i].state != slot_state::empty)
+                    i = (i + 1) & mask();
+                slots[i] = std::move(entry);
+            }
+        }
+    };
+
+    // Resolves a pending slot. If the computation never finishes, e.g. because it or finish() threw, the
+    // slot is removed and waiters look the key up again. locker may or may not hold s.lock by then.
+    struct completion {
+        memoize_expected& owner;
+        shard& s;
+        std::unique_lock<std::mutex>& locker;
+        std::size_t hash;
+        const Key& key;
+        std::shared_ptr<flight> computing;
+        bool finished { false };
+
+        void finish(const result_type& result)
+        {
+            keep(computing->result, result);
+            slot* entry = s.find(hash, key);
+            if (entry && entry->pending == computing) {
+                std::chrono::nanoseconds ttl = computing->result->has_value() ? owner.policy.value_ttl : owner.policy.error_ttl;
+                if (ttl > std::chrono::nanoseconds::zero()) {
+                    entry->state = slot_state::ready;
+                    entry->expiry = expiry(ttl);
+                    keep(entry->result, result);
+                    entry->pending.reset();
+                    --s.inFlight;
+                } else
+                    s.remove(*entry);
+            }
+            finished = true;
+        }
+
+        ~completion()
+        {
+            if (!finished) {
+                if (!locker.owns_lock())
+                    locker.lock();
+                slot* entry = s.find(hash, key);
+                if (entry && entry->pending == computing)
+                    s.remove(*entry);
+                computing->done = true;
+            } else
+                computing->done = true;
+            s.ready.notify_all();
+        }
+
+        // Callers check the copies they're handed, so the cache's own copies count as checked. The caller's
+        // result is only read through its copy, which leaves it for the caller to check.
+        static void keep(std::optional<result_type>& where, const result_type& result)
+        {
+            where.emplace(result);
+            where->has_value();
+        }
+
+        static time_point expiry(std::chrono::nanoseconds ttl)
+        {
+            time_point now = Clock::now();
+            if (ttl >= std::chrono::duration_cast<std::chrono::nanoseconds>(time_point::max() - now))
+                return time_point::max();
+            return now + std::chrono::duration_cast<typename Clock::duration>(ttl);
+        }
+    };
+
+    // Slots are picked with the low bits of the hash, so shards are picked with the high bits of a remix of
+    // it. Otherwise, all the keys in a shard could share their low bits and pile up on a few home slots.
+    shard& shardFor(std::size_t hash) const
+    {
+        std::uint64_t mixed = static_cast<std::uint64_t>(hash) * 0x9e3779b97f4a7c15ull;
+        return shards[static_cast<std::size_t>(mixed >> 32) % shardCount];
+    }
+
+    function_type function;
+    memoize_policy policy;
+    std::size_t shardCount;
+    std::unique_ptr<shard[]> shards;
+};
+
+WTF_EXPECTED_NAMESPACE_END
+
+} // namespace WTF
+
+using WTF::memoize_expected;
+using WTF::memoize_policy;
+using WTF::memoize_statistics;
+
+#endif